@@ -0,0 +1,178 @@
+#ifndef BLOCK_SCHEDULER_H
+#define BLOCK_SCHEDULER_H
+
+#include "Minisymposia.hpp"
+#include "Scheduler.hpp"
+#include <string>
+
+// The parts of BlockScheduler used inside kernels.  Each gene is an item: a
+// whole multipart minisymposium, a minisymposium with one part, or an empty
+// cell.  A member is a permutation of the items, and crossover and mutation
+// move each chain as a single gene.  decode lays the items out room by room,
+// and usually each chain fills consecutive timeslots of one room in order.
+// A chain is split across rooms when it fits neither in the rest of the
+// current room nor below the chains already deferred to the next room, and
+// then the full prerequisite penalties are computed.
+class DeviceBlockScheduler {
+public:
+  DeviceBlockScheduler(const Minisymposia& mini);
+
+  template<class View1D>
+  KOKKOS_INLINE_FUNCTION double rate(View1D items, bool verbose=false) const;
+
+  template<class TeamMember, class View1D>
+  KOKKOS_INLINE_FUNCTION double team_rate(const TeamMember& team, View1D items) const;
+  size_t team_scratch_size() const;
+
+  // Writes the schedule described by items, returning false if any chain
+  // had to be split across rooms
+  template<class View1D, class OffsetView, class CellView, class View2D>
+  KOKKOS_INLINE_FUNCTION static bool decode(View1D items, OffsetView item_offsets,
+    CellView item_cells, View2D schedule);
+
+  KOKKOS_FUNCTION bool out_of_bounds(unsigned i) const;
+  KOKKOS_FUNCTION unsigned nslots() const;
+  KOKKOS_FUNCTION unsigned nrooms() const;
+
+protected:
+  DeviceMinisymposia mini_;
+  // The cells of item i are item_cells_(item_offsets_(i)), ..., item_cells_(item_offsets_(i+1)-1).
+  // Empty cells hold an index of at least mini_.size(), like in a schedule.
+  Kokkos::View<unsigned*> item_offsets_;
+  Kokkos::View<unsigned*> item_cells_;
+  // The items below this one hold minisymposia
+  unsigned nfilled_items_;
+  // Each thread decodes into its own schedule.  The token is instance scoped,
+  // so its pool is separate from the position token that rate_schedule
+  // acquires while this one is held.
+  Kokkos::View<unsigned***> schedules_;
+  Kokkos::Experimental::UniqueToken<Kokkos::DefaultExecutionSpace,
+    Kokkos::Experimental::UniqueTokenScope::Instance> schedule_token_;
+};
+
+// Gene is the type of the item indices; see BasicScheduler
+template<class Gene>
+class BasicBlockScheduler : public DeviceBlockScheduler {
+public:
+  typedef Kokkos::View<Gene**> ViewType;
+  typedef DeviceBlockScheduler DeviceHandle;
+
+  BasicBlockScheduler(const Minisymposia& mini);
+  ViewType make_initial_population(unsigned nschedules) const;
+  unsigned nitems() const;
+  const DeviceHandle& device_handle() const;
+
+  template<class View1D>
+  inline void greedy(View1D items) const;
+
+  template<class View1D>
+  inline void record(const std::string& filename, View1D items) const;
+
+private:
+  // Host copies, so record can decode on a writer thread
+  Kokkos::View<unsigned*>::HostMirror h_item_offsets_;
+  Kokkos::View<unsigned*>::HostMirror h_item_cells_;
+  Scheduler scheduler_;
+};
+
+typedef BasicBlockScheduler<unsigned> BlockScheduler;
+
+template<class View1D>
+double DeviceBlockScheduler::rate(View1D items, bool verbose) const {
+  int token = schedule_token_.acquire();
+  auto schedule = Kokkos::subview(schedules_, token, Kokkos::ALL(), Kokkos::ALL());
+  bool intact = decode(items, item_offsets_, item_cells_, schedule);
+
+  SchedulePenalties penalties;
+  double result = mini_.rate_schedule(schedule, penalties.order, penalties.gumband_time, penalties.gumband_room,
+                                      penalties.oversubscribed, penalties.theme, penalties.timeslot,
+                                      penalties.room, penalties.priority, false, intact);
+  schedule_token_.release(token);
+
+  if(verbose) {
+    printf("%i,%i,%i,%i,%e,%e,%e,%e,",
+    penalties.oversubscribed,
+    penalties.room,
+    penalties.timeslot,
+    penalties.order,
+    mini_.map_priority_penalty(penalties.priority),
+    penalties.theme,
+    penalties.gumband_time/(double)mini_.get_nprereqs(),
+    penalties.gumband_room/(double)mini_.get_nprereqs());
+  }
+  return result;
+}
+
+// Decoding is sequential, so one thread of the team rates the whole schedule
+template<class TeamMember, class View1D>
+double DeviceBlockScheduler::team_rate(const TeamMember& team, View1D items) const {
+  double result;
+  Kokkos::single(Kokkos::PerTeam(team), [&](double& lresult) {
+    lresult = rate(items);
+  }, result);
+  return result;
+}
+
+// The items are placed in order, filling each room from its first timeslot.
+// A chain that does not fit in the rest of the current room goes to the top
+// of the next room, and the items after it fill the current room first.  If
+// the next room has too few timeslots left below the earlier deferred chains,
+// or the current room is the last, the chain continues into the next room.
+template<class View1D, class OffsetView, class CellView, class View2D>
+bool DeviceBlockScheduler::decode(View1D items, OffsetView item_offsets,
+  CellView item_cells, View2D schedule)
+{
+  unsigned nslots = schedule.extent(0);
+  unsigned nrooms = schedule.extent(1);
+  // The next free cell
+  unsigned sl = 0, r = 0;
+  // The number of timeslots at the top of room r+1 taken by deferred chains
+  unsigned reserved = 0;
+  bool intact = true;
+
+  for(unsigned i=0; i<items.extent(0); i++) {
+    unsigned item = items(i);
+    unsigned begin = item_offsets(item);
+    unsigned length = item_offsets(item+1) - begin;
+    if(sl + length > nslots) {
+      if(r+1 < nrooms && reserved + length <= nslots) {
+        for(unsigned k=0; k<length; k++) {
+          schedule(reserved+k, r+1) = item_cells(begin+k);
+        }
+        reserved += length;
+        continue;
+      }
+      // The chain is split across rooms
+      intact = false;
+    }
+    for(unsigned k=0; k<length; k++) {
+      schedule(sl, r) = item_cells(begin+k);
+      sl++;
+      // Move to the next room, skipping its reserved timeslots
+      while(sl == nslots && r+1 < nrooms) {
+        r++;
+        sl = reserved;
+        reserved = 0;
+      }
+    }
+  }
+  return intact;
+}
+
+template<class Gene>
+template<class View1D>
+void BasicBlockScheduler<Gene>::greedy(View1D items) const {
+  for(unsigned i=0; i<items.extent(0); i++) {
+    items(i) = i;
+  }
+}
+
+template<class Gene>
+template<class View1D>
+void BasicBlockScheduler<Gene>::record(const std::string& filename, View1D items) const {
+  Kokkos::View<unsigned**, Kokkos::HostSpace> schedule("decoded schedule", nslots(), nrooms());
+  decode(items, h_item_offsets_, h_item_cells_, schedule);
+  scheduler_.record(filename, schedule);
+}
+
+#endif /* BLOCK_SCHEDULER_H */
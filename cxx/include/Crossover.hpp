@@ -0,0 +1,188 @@
+#ifndef CROSSOVER_H
+#define CROSSOVER_H
+
+#include "Utility.hpp"
+#include "Kokkos_Core.hpp"
+
+namespace genetic {
+
+// Accesses the genes of a population member as a flat array, whether the
+// member is a mapping or a schedule.  Schedules are flattened room by room,
+// so a contiguous range of genes covers a band of rooms.
+template<class ViewType>
+class Genes {
+public:
+  typedef typename ViewType::non_const_value_type value_type;
+  // Marks a gene that has not been filled yet
+  static constexpr value_type unset = value_type(-1);
+
+  KOKKOS_INLINE_FUNCTION Genes(ViewType view) : view_(view) { }
+
+  KOKKOS_INLINE_FUNCTION unsigned size() const {
+    return view_.size();
+  }
+
+  KOKKOS_INLINE_FUNCTION auto& operator()(unsigned k) const {
+    if constexpr(ViewType::rank == 1) {
+      return view_(k);
+    }
+    else {
+      return view_(k % view_.extent(0), k / view_.extent(0));
+    }
+  }
+private:
+  ViewType view_;
+};
+
+template<class ViewType>
+KOKKOS_INLINE_FUNCTION Genes<ViewType> make_genes(ViewType view) {
+  return Genes<ViewType>(view);
+}
+
+// Picks the nonempty segment [start, end) of genes that comes from the mom,
+// which never covers every gene
+template<class Generator>
+KOKKOS_INLINE_FUNCTION void random_segment(Generator& gen, unsigned ngenes, unsigned& start, unsigned& end) {
+  start = gen.rand(ngenes+1);
+  end = start;
+  while(end == start || Kokkos::abs((int)end - (int)start) >= ngenes) {
+    end = gen.rand(ngenes+1);
+  }
+  if(end < start) {
+    swap(start, end);
+  }
+}
+
+// Crossover policies for Genetic.  Each combines the mom and dad into the
+// child, which must be a permutation of the same genes.  scratch holds one
+// entry per gene value.
+
+// Copies a segment from the mom and fills the rest with the dad's genes,
+// following the mapping defined by the segment whenever a gene is taken
+struct PartiallyMappedCrossover {
+  template<class GenesType, class Generator, class ScratchType>
+  KOKKOS_INLINE_FUNCTION static void breed(const GenesType& mom, const GenesType& dad, const GenesType& child,
+                                           Generator& gen, ScratchType position) {
+    unsigned ngenes = child.size();
+    unsigned start, end;
+    random_segment(gen, ngenes, start, end);
+
+    // Record where each of the mom's genes lives in the segment
+    for(unsigned v=0; v<ngenes; v++) {
+      position(v) = unsigned(-1);
+    }
+    for(unsigned k=start; k<end; k++) {
+      child(k) = mom(k);
+      position(mom(k)) = k;
+    }
+
+    // Fill in the gaps with dad's info
+    for(unsigned k=0; k<ngenes; k++) {
+      if(k >= start && k < end) continue;
+      // Follow the mapping until the dad's value is not already in child
+      unsigned current = k;
+      while(position(dad(current)) != unsigned(-1)) {
+        current = position(dad(current));
+      }
+      child(k) = dad(current);
+    }
+  }
+};
+
+// Copies a segment from the mom and fills the rest with the remaining genes
+// in the order they appear in the dad, starting after the segment
+struct OrderCrossover {
+  template<class GenesType, class Generator, class ScratchType>
+  KOKKOS_INLINE_FUNCTION static void breed(const GenesType& mom, const GenesType& dad, const GenesType& child,
+                                           Generator& gen, ScratchType taken) {
+    unsigned ngenes = child.size();
+    unsigned start, end;
+    random_segment(gen, ngenes, start, end);
+
+    for(unsigned v=0; v<ngenes; v++) {
+      taken(v) = false;
+    }
+    for(unsigned k=start; k<end; k++) {
+      child(k) = mom(k);
+      taken(mom(k)) = true;
+    }
+
+    unsigned d = end % ngenes;
+    for(unsigned k=end; k<end+ngenes-(end-start); k++) {
+      while(taken(dad(d))) {
+        d = (d+1) % ngenes;
+      }
+      child(k % ngenes) = dad(d);
+      d = (d+1) % ngenes;
+    }
+  }
+};
+
+// Splits the genes into the cycles defined by the two parents, taking
+// alternate cycles from the mom and the dad, so every gene keeps the
+// position it had in one of the parents
+struct CycleCrossover {
+  template<class GenesType, class Generator, class ScratchType>
+  KOKKOS_INLINE_FUNCTION static void breed(const GenesType& mom, const GenesType& dad, const GenesType& child,
+                                           Generator& gen, ScratchType position) {
+    unsigned ngenes = child.size();
+    for(unsigned k=0; k<ngenes; k++) {
+      position(mom(k)) = k;
+      child(k) = GenesType::unset;
+    }
+
+    bool from_mom = true;
+    for(unsigned start=0; start<ngenes; start++) {
+      if(child(start) != GenesType::unset) continue;
+      unsigned k = start;
+      do {
+        child(k) = from_mom ? mom(k) : dad(k);
+        k = position(dad(k));
+      } while(k != start);
+      from_mom = !from_mom;
+    }
+  }
+};
+
+// Keeps a random half of the mom's genes in place, also known as uniform
+// order crossover, and fills the other positions in the dad's order
+struct PositionBasedCrossover {
+  template<class GenesType, class Generator, class ScratchType>
+  KOKKOS_INLINE_FUNCTION static void breed(const GenesType& mom, const GenesType& dad, const GenesType& child,
+                                           Generator& gen, ScratchType taken) {
+    unsigned ngenes = child.size();
+    for(unsigned v=0; v<ngenes; v++) {
+      taken(v) = false;
+    }
+
+    // Draw the positions 64 at a time
+    uint64_t bits = 0;
+    for(unsigned k=0; k<ngenes; k++) {
+      if(k % 64 == 0) {
+        bits = gen.urand64();
+      }
+      if(bits & 1) {
+        child(k) = mom(k);
+        taken(mom(k)) = true;
+      }
+      else {
+        child(k) = GenesType::unset;
+      }
+      bits >>= 1;
+    }
+
+    unsigned d = 0;
+    for(unsigned k=0; k<ngenes; k++) {
+      if(child(k) != GenesType::unset) continue;
+      while(taken(dad(d))) {
+        d++;
+      }
+      child(k) = dad(d);
+      d++;
+    }
+  }
+};
+
+} // namespace genetic
+
+#endif /* CROSSOVER_H */
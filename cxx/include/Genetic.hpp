@@ -1,376 +1,866 @@
 #ifndef GENETIC_H
 #define GENETIC_H
 
+#include "Crossover.hpp"
+#include "Random.hpp"
+#include "Selection.hpp"
 #include "Utility.hpp"
 #include "Kokkos_Random.hpp"
 #include "Kokkos_Sort.hpp"
 #include "Kokkos_StdAlgorithms.hpp"
+#include <cstdio>
+#include <future>
+#include <limits>
+#include <memory>
 #include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
-template<class Runner>
+// Wall-clock time spent in each phase of the genetic algorithm, in seconds
+struct GeneticTimings {
+  double initialize{0}, rate{0}, sort{0}, weights{0}, breed{0}, mutate{0}, fused{0};
+  unsigned generations{0};
+};
+
+// Why Genetic::run returned
+enum class StopReason { generations, time_limit, target_rating, stalled };
+
+inline const char* to_string(StopReason reason) {
+  switch(reason) {
+    case StopReason::time_limit: return "time limit reached";
+    case StopReason::target_rating: return "target rating reached";
+    case StopReason::stalled: return "no improvement within the stall limit";
+    default: return "all generations completed";
+  }
+}
+
+// Orders rating indices by rating, breaking ties by index so the order is unique
+struct RatingOrder {
+  Kokkos::View<double*> ratings;
+  KOKKOS_INLINE_FUNCTION bool operator()(unsigned a, unsigned b) const {
+    return ratings(a) < ratings(b) || (ratings(a) == ratings(b) && a < b);
+  }
+};
+
+// Detects the optional DeviceHandle::seed_member(genes, gen) hook, which
+// replaces the uniform shuffle of a new member, e.g. to favour feasible ones
+template<class Handle, class GenesType, class Generator, class = void>
+struct has_seed_member : std::false_type { };
+
+template<class Handle, class GenesType, class Generator>
+struct has_seed_member<Handle, GenesType, Generator,
+  std::void_t<decltype(std::declval<const Handle&>().seed_member(std::declval<const GenesType&>(),
+                                                                   std::declval<Generator&>()))>> : std::true_type { };
+
+// Detects the optional DeviceHandle::mutate_within_rows() hook.  Without it,
+// mutations swap genes within a row, such as the rooms of a timeslot.
+template<class Handle, class = void>
+struct has_mutate_within_rows : std::false_type { };
+
+template<class Handle>
+struct has_mutate_within_rows<Handle,
+  std::void_t<decltype(std::declval<const Handle&>().mutate_within_rows())>> : std::true_type { };
+
+// Detects the optional DeviceHandle::accepts_swap(genes, k1, k2) hook, which
+// lets the runner reject a mutation, e.g. one that breaks a hard constraint
+template<class Handle, class GenesType, class = void>
+struct has_accepts_swap : std::false_type { };
+
+template<class Handle, class GenesType>
+struct has_accepts_swap<Handle, GenesType,
+  std::void_t<decltype(std::declval<const Handle&>().accepts_swap(std::declval<const GenesType&>(),
+                                                                  0u, 0u))>> : std::true_type { };
+
+template<class Runner, class Crossover = genetic::PartiallyMappedCrossover, 
+         class Selection = genetic::RouletteSelection>
 class Genetic {
 public:
   Genetic(Runner& runner);
-  auto run(unsigned popSize, unsigned eliteSize, double mutationRate, unsigned generations);
+  auto run(unsigned popSize, unsigned eliteSize, double mutationRate, unsigned generations,
+           uint64_t seed=5374857);
+  auto resume(const std::string& checkpoint, unsigned eliteSize, double mutationRate, unsigned generations);
 
   // These items should be private but have to be public because #GPUs
-  void rate_population();
-  void compute_weights();
+  void rate_population(unsigned nmembers);
+  void prepare_selection(unsigned eliteSize);
+  void assign_slots(unsigned eliteSize);
   void breed_population(unsigned eliteSize);
-  void mutate_population(double mutationRate);
+  void mutate_population(unsigned eliteSize, double mutationRate);
+  void evolve_population(unsigned eliteSize, double mutationRate);
+
+  // The fused pass rates each child on the thread that bred it, so it takes
+  // precedence over team rating, which only applies to rate_population
+  void set_fused(bool fused);
+  void set_top_k_elites(bool top_k);
+  void set_team_rating(bool team_rating);
+  void set_deterministic(bool deterministic);
+  void set_time_limit(double seconds);
+  void set_target_rating(double rating);
+  void set_stall_limit(unsigned generations);
+  void set_checkpoint(const std::string& filename, unsigned interval);
+  const GeneticTimings& timings() const;
+  StopReason stop_reason() const;
+  double best_rating() const;
 private:
+  typedef typename Runner::ViewType::non_const_value_type Gene;
+
+  void allocate(unsigned popSize, unsigned eliteSize);
+  auto iterate(unsigned first_generation, unsigned eliteSize, double mutationRate, unsigned generations);
+  Kokkos::View<unsigned*> ranking() const;
+  uint64_t checkpoint_seed(unsigned generation) const;
+  void write_checkpoint(unsigned generation, unsigned eliteSize);
+  void read_checkpoint(const std::string& filename, unsigned eliteSize, unsigned& generation);
+  void rank_population();
   void sort();
+  void select_elites();
+  KOKKOS_INLINE_FUNCTION static unsigned get_bin(double rating, double min, double width, unsigned nbins);
   auto get_best_member();
+  auto host_best_member() const;
+  void copy_best_member();
+  void snapshot(const std::string& filename);
+  KOKKOS_INLINE_FUNCTION static auto member_of(const typename Runner::ViewType& view, unsigned i);
   KOKKOS_INLINE_FUNCTION auto get_population_member(unsigned i, bool current=true) const;
+  auto population_slots(Kokkos::pair<unsigned, unsigned> slots) const;
+  typename Runner::ViewType gather_members() const;
   void make_initial_population(unsigned popSize);
-  KOKKOS_INLINE_FUNCTION unsigned get_parent() const;
-  KOKKOS_INLINE_FUNCTION void breed(unsigned mom_index, unsigned dad_index, unsigned child_index) const;
+  // Scratch space for the crossover, with one entry per gene value
+  typedef Kokkos::View<unsigned*, Kokkos::DefaultExecutionSpace::scratch_memory_space, 
+                       Kokkos::MemoryUnmanaged> ScratchView;
+  template<class Functor>
+  void parallel_for_children(const std::string& label, unsigned nchildren, const Functor& functor);
+  KOKKOS_INLINE_FUNCTION unsigned member_at(unsigned rating_index) const;
+  template<class Functor>
+  KOKKOS_INLINE_FUNCTION void with_generator(unsigned member, genetic::RandomOperation op, Functor functor) const;
+  void sort_by_rating(Kokkos::View<unsigned*> indices) const;
+  KOKKOS_INLINE_FUNCTION void breed(unsigned mom_index, unsigned dad_index, unsigned child_index,
+                                    ScratchView scratch) const;
+  KOKKOS_INLINE_FUNCTION void make_child(unsigned child_index, ScratchView scratch) const;
+  KOKKOS_INLINE_FUNCTION void mutate(unsigned child_index, double mutationRate) const;
 
-  Runner runner_;
-  typename Runner::ViewType current_population_;
-  typename Runner::ViewType next_population_;
+  // Kernels only capture the runner's lightweight device handle, since
+  // KOKKOS_CLASS_LAMBDA copies *this on every launch
+  Runner& runner_;
+  typename Runner::DeviceHandle handle_;
+  // Genomes live in slots of population_, and members_ maps each member to
+  // its slot.  The elites keep their slot and rating in the next generation,
+  // so only the children are written and rated; they take the free slots,
+  // which no member of the current generation uses.
+  typename Runner::ViewType population_;
+  Kokkos::View<unsigned*> members_;
+  Kokkos::View<unsigned*> next_members_;
+  Kokkos::View<unsigned*> free_slots_;
+  Kokkos::View<bool*> slot_used_;
   Kokkos::View<double*> ratings_;
-  Kokkos::View<double*> weights_;
+  Kokkos::View<double*> next_ratings_;
+  Selection selection_;
+  double min_rating_;
   Kokkos::View<unsigned*> permutation_;
+  // The deterministic sort permutes the ratings into this buffer and then
+  // swaps it with ratings_
+  Kokkos::View<double*> sorted_ratings_;
+  unsigned best_member_;
+  double best_rating_;
+  // Used instead of permutation_ when only the elites are selected
+  Kokkos::View<unsigned*> elites_;
+  Kokkos::View<unsigned*> candidates_;
+  Kokkos::View<double*> candidate_ratings_;
+  Kokkos::View<unsigned*> bin_counts_;
+  GeneticTimings timings_;
+  bool fused_{false};
+  bool top_k_{false};
+  bool team_rating_{false};
+  // Draw from counter-based streams instead of the pool, making runs reproducible
+  bool deterministic_{false};
+  unsigned generation_{0};
+  // Termination criteria; zero disables the time and stall limits
+  double time_limit_{0};
+  double target_rating_{std::numeric_limits<double>::infinity()};
+  unsigned stall_limit_{0};
+  // The generation that last raised the best rating, saved in checkpoints
+  // so a resumed run keeps counting towards the stall limit
+  unsigned last_improvement_{0};
+  StopReason stop_reason_{StopReason::generations};
+  Kokkos::Timer run_timer_;
+  // Checkpoints are written every checkpoint_interval_ generations; zero disables them
+  unsigned checkpoint_interval_{0};
+  // Persistent buffers holding a copy of the best member
+  typename Runner::ViewType best_device_;
+  typename Runner::ViewType::HostMirror best_host_;
+  // The writer threads and the checkpoint file live behind a pointer, so
+  // kernels copying *this do not copy the string and the futures
+  struct Writers {
+    std::string checkpoint_file;
+    std::shared_future<void> checkpoint;
+    std::shared_future<void> snapshot;
+  };
+  std::shared_ptr<Writers> writers_{std::make_shared<Writers>()};
   std::default_random_engine rng_;
+  uint64_t seed_{5374857};
   Kokkos::Random_XorShift64_Pool<> pool_;
 };
 
-template<class Runner>
-Genetic<Runner>::Genetic(Runner& runner) : runner_(runner), pool_(5374857) { }
+template<class Runner, class Crossover, class Selection>
+Genetic<Runner, Crossover, Selection>::Genetic(Runner& runner) : 
+  runner_(runner), handle_(runner.device_handle()), pool_(seed_) { }
+
+template<class Runner, class Crossover, class Selection>
+auto Genetic<Runner, Crossover, Selection>::run(unsigned popSize, unsigned eliteSize, double mutationRate, unsigned generations,
+                                                 uint64_t seed) {
+  seed_ = seed;
+  rng_.seed(seed);
+  pool_.init(seed, pool_.get_num_states());
+  allocate(popSize, eliteSize);
+
+  Kokkos::Timer timer;
+  generation_ = 0;
+  make_initial_population(popSize);
+  timings_.initialize = timer.seconds();
+
+  std::cout << "generation 0: ";
+  timer.reset();
+  rate_population(popSize);
+  timings_.rate += timer.seconds();
+  timer.reset();
+  rank_population();
+  timings_.sort += timer.seconds();
+
+  last_improvement_ = 0;
+  return iterate(0, eliteSize, mutationRate, generations);
+}
+
+// Continues a run from a checkpoint written by a previous call to run,
+// producing the same generations the original run would have
+template<class Runner, class Crossover, class Selection>
+auto Genetic<Runner, Crossover, Selection>::resume(const std::string& checkpoint, unsigned eliteSize, double mutationRate, unsigned generations) {
+  unsigned first_generation;
+  Kokkos::Timer timer;
+  read_checkpoint(checkpoint, eliteSize, first_generation);
+  timings_.initialize = timer.seconds();
+  std::cout << "resuming from generation " << first_generation << ": " << best_rating_ << std::endl;
+
+  rng_.seed(checkpoint_seed(first_generation));
+  pool_.init(checkpoint_seed(first_generation), pool_.get_num_states());
+  return iterate(first_generation, eliteSize, mutationRate, generations);
+}
 
-template<class Runner>
-auto Genetic<Runner>::run(unsigned popSize, unsigned eliteSize, double mutationRate, unsigned generations) {
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::allocate(unsigned popSize, unsigned eliteSize) {
   // Allocate space for the Kokkos Views
   ratings_ = Kokkos::View<double*>("ratings", popSize);
-  weights_ = Kokkos::View<double*>("weights", popSize);
+  next_ratings_ = Kokkos::View<double*>("next ratings", popSize);
 
-  make_initial_population(popSize);
+  // Every member has a slot, and every child of the next generation needs
+  // a slot that no current member uses
+  unsigned nslots = 2*popSize - eliteSize;
+  population_ = runner_.make_initial_population(nslots);
+  members_ = Kokkos::View<unsigned*>("member slots", popSize);
+  next_members_ = Kokkos::View<unsigned*>("next member slots", popSize);
+  free_slots_ = Kokkos::View<unsigned*>("free slots", popSize - eliteSize);
+  slot_used_ = Kokkos::View<bool*>("used slots", nslots);
+  auto members = members_;
+  auto free_slots = free_slots_;
+  Kokkos::parallel_for("Initial slots", popSize, KOKKOS_LAMBDA (unsigned i) {
+    members(i) = i;
+    if(i < popSize - eliteSize) {
+      free_slots(i) = popSize + i;
+    }
+  });
 
-  for(unsigned g=0; g<generations; g++) {
-    std::cout << "generation " << g << ": ";
+  if(top_k_) {
+    elites_ = Kokkos::View<unsigned*>("elites", eliteSize);
+    candidates_ = Kokkos::View<unsigned*>("elite candidates", popSize);
+    candidate_ratings_ = Kokkos::View<double*>("elite candidate ratings", popSize);
+    bin_counts_ = Kokkos::View<unsigned*>("rating bin counts", eliteSize);
+  }
+  else if(deterministic_) {
+    permutation_ = Kokkos::View<unsigned*>("permutation", popSize);
+    sorted_ratings_ = Kokkos::View<double*>("sorted ratings", popSize);
+  }
+  best_device_ = runner_.make_initial_population(1);
+  best_host_ = Kokkos::create_mirror_view(best_device_);
+  timings_ = GeneticTimings();
+  stop_reason_ = StopReason::generations;
+  if(fused_ && team_rating_) {
+    printf("Team rating is ignored: the fused pipeline rates each child on the thread that bred it\n");
+  }
+  run_timer_.reset();
+}
 
-    rate_population();
-    sort();
+// Evolves a ranked population from first_generation up to generations
+template<class Runner, class Crossover, class Selection>
+auto Genetic<Runner, Crossover, Selection>::iterate(unsigned first_generation, unsigned eliteSize, double mutationRate, unsigned generations) {
+  Kokkos::Timer timer;
+  double best_so_far = best_rating_;
+  for(unsigned g=first_generation; g<generations; g++) {
+    generation_ = g;
+    if(best_rating_ >= target_rating_) {
+      stop_reason_ = StopReason::target_rating;
+      break;
+    }
+    if(time_limit_ > 0 && run_timer_.seconds() >= time_limit_) {
+      stop_reason_ = StopReason::time_limit;
+      break;
+    }
+    if(stall_limit_ > 0 && g - last_improvement_ >= stall_limit_) {
+      stop_reason_ = StopReason::stalled;
+      break;
+    }
+
+    // Reseed at every checkpoint so a resumed run draws the same numbers
+    if(checkpoint_interval_ > 0 && g % checkpoint_interval_ == 0 && g != first_generation) {
+      write_checkpoint(g, eliteSize);
+      rng_.seed(checkpoint_seed(g));
+      pool_.init(checkpoint_seed(g), pool_.get_num_states());
+    }
 
     if(g % 100 == 0) {
-      runner_.record("iteration" + std::to_string(g) + ".md", get_best_member());
+      snapshot("iteration" + std::to_string(g) + ".md");
     }
 
-    compute_weights();
-    breed_population(eliteSize);
-    mutate_population(mutationRate);
-    std::swap(current_population_, next_population_);
-  }
+    timer.reset();
+    prepare_selection(eliteSize);
+    timings_.weights += timer.seconds();
 
-  std::cout << "generation " << generations << ": ";
-  rate_population();
-  sort();
+    if(fused_) {
+      // Breed, mutate and rate each child in a single pass
+      timer.reset();
+      evolve_population(eliteSize, mutationRate);
+      timings_.fused += timer.seconds();
+    }
+    else {
+      timer.reset();
+      breed_population(eliteSize);
+      timings_.breed += timer.seconds();
+
+      timer.reset();
+      mutate_population(eliteSize, mutationRate);
+      timings_.mutate += timer.seconds();
+    }
+
+    std::swap(members_, next_members_);
+    std::swap(ratings_, next_ratings_);
+    timings_.generations++;
+
+    std::cout << "generation " << g+1 << ": ";
+    if(!fused_) {
+      // The elites kept their ratings, so only the children are rated
+      timer.reset();
+      rate_population(members_.extent(0) - eliteSize);
+      timings_.rate += timer.seconds();
+    }
+    timer.reset();
+    rank_population();
+    timings_.sort += timer.seconds();
+
+    if(best_rating_ > best_so_far) {
+      best_so_far = best_rating_;
+      last_improvement_ = g+1;
+    }
+  }
 
+  printf("Stopped after %u generations: %s\n", timings_.generations, to_string(stop_reason_));
+  if(writers_->checkpoint.valid()) {
+    writers_->checkpoint.wait();
+  }
   return get_best_member();
 }
 
-template<class Runner>
-auto Genetic<Runner>::get_population_member(unsigned i, bool current) const {
-  if constexpr(current_population_.rank == 2) {
-    if(current) {
-      return Kokkos::subview(current_population_, i, Kokkos::ALL());
-    }
-    return Kokkos::subview(next_population_, i, Kokkos::ALL());
+// Checkpoint layout: a header of extents and scalars, followed by the raw
+// population, the ratings and the ranking consumed by the next generation
+struct CheckpointHeader {
+  char magic[4];
+  unsigned extents[3];
+  unsigned generation;
+  unsigned last_improvement;
+  unsigned elite_size;
+  unsigned top_k;
+  unsigned ranking_size;
+  unsigned best_member;
+  unsigned gene_size;
+  uint64_t seed;
+  double min_rating;
+  double best_rating;
+};
+
+template<class Runner, class Crossover, class Selection>
+Kokkos::View<unsigned*> Genetic<Runner, Crossover, Selection>::ranking() const {
+  return top_k_ ? elites_ : permutation_;
+}
+
+template<class Runner, class Crossover, class Selection>
+uint64_t Genetic<Runner, Crossover, Selection>::checkpoint_seed(unsigned generation) const {
+  return seed_ ^ (generation * 0x9E3779B97F4A7C15ull);
+}
+
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::write_checkpoint(unsigned generation, unsigned eliteSize) {
+  // Wait for the previous checkpoint before reusing its buffers
+  if(writers_->checkpoint.valid()) {
+    writers_->checkpoint.wait();
   }
-  else {
-    if(current) {
-      return Kokkos::subview(current_population_, i, Kokkos::ALL(), Kokkos::ALL());
-    }
-    return Kokkos::subview(next_population_, i, Kokkos::ALL(), Kokkos::ALL());
+
+  CheckpointHeader header{{'G','A','C','K'}, {1, 1, 1}, generation, last_improvement_, eliteSize,
+                          top_k_, 0, best_member_, sizeof(Gene), seed_, min_rating_, best_rating_};
+  // Copy the state to the host in member order; only the file output runs
+  // in the background.  create_mirror always allocates, so the writer owns
+  // its buffers even on host backends, where the ratings and ranking are
+  // rewritten by the next generations.
+  auto population = gather_members();
+  for(unsigned d=0; d<population.rank; d++) {
+    header.extents[d] = population.extent(d);
   }
+  auto ranking = this->ranking();
+  auto h_population = Kokkos::create_mirror(Kokkos::HostSpace(), population);
+  auto h_ratings = Kokkos::create_mirror(Kokkos::HostSpace(), ratings_);
+  auto h_ranking = Kokkos::create_mirror(Kokkos::HostSpace(), ranking);
+  Kokkos::deep_copy(h_population, population);
+  Kokkos::deep_copy(h_ratings, ratings_);
+  Kokkos::deep_copy(h_ranking, ranking);
+  header.ranking_size = h_ranking.extent(0);
+
+  std::string filename = writers_->checkpoint_file;
+  writers_->checkpoint = std::async(std::launch::async, [=]() {
+    // Write to a temporary file so a crash never leaves a partial checkpoint
+    std::string temp = filename + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+    if(!file) {
+      printf("Unable to write checkpoint %s\n", temp.c_str());
+      return;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(h_population.data(), sizeof(Gene), h_population.size(), file);
+    fwrite(h_ratings.data(), sizeof(double), h_ratings.size(), file);
+    fwrite(h_ranking.data(), sizeof(unsigned), h_ranking.size(), file);
+    fclose(file);
+    std::rename(temp.c_str(), filename.c_str());
+  }).share();
 }
 
-template<class Runner>
-void Genetic<Runner>::make_initial_population(unsigned popSize) {
-  // Allocate memory for the population
-  current_population_ = runner_.make_initial_population(popSize);
-  next_population_ = runner_.make_initial_population(popSize);
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::read_checkpoint(const std::string& filename, unsigned eliteSize, unsigned& generation) {
+  FILE* file = fopen(filename.c_str(), "rb");
+  if(!file) {
+    throw std::runtime_error("Unable to open checkpoint " + filename);
+  }
+  CheckpointHeader header;
+  if(fread(&header, sizeof(header), 1, file) != 1 || std::string(header.magic, 4) != "GACK") {
+    fclose(file);
+    throw std::runtime_error(filename + " is not a checkpoint");
+  }
 
-  // Calculate how much data is in a single population member
-  unsigned nentries = current_population_.extent(1);
-  if(current_population_.rank == 3) {
-    nentries *= current_population_.extent(2);
+  unsigned popSize = header.extents[0];
+  top_k_ = header.top_k;
+  seed_ = header.seed;
+  allocate(popSize, eliteSize);
+  auto population = runner_.make_initial_population(popSize);
+  if(header.gene_size != sizeof(Gene)) {
+    fclose(file);
+    throw std::runtime_error(filename + " was written with a different gene type");
+  }
+  for(unsigned d=0; d<population.rank; d++) {
+    if(population.extent(d) != header.extents[d]) {
+      fclose(file);
+      throw std::runtime_error(filename + " does not match this problem");
+    }
+  }
+  if(header.elite_size != eliteSize) {
+    fclose(file);
+    throw std::runtime_error(filename + " was written with a different elite size");
+  }
+  if(!top_k_) {
+    permutation_ = Kokkos::View<unsigned*>("permutation", popSize);
   }
 
-  // Create a vector of integers [0, popSize)
-  // We will permute this to get our population members
-  std::vector<unsigned> ints(nentries);
-  for(unsigned i=0; i<nentries; i++) {
-    ints[i] = i;
+  auto h_population = Kokkos::create_mirror_view(population);
+  auto h_ratings = Kokkos::create_mirror_view(ratings_);
+  auto h_ranking = Kokkos::create_mirror_view(ranking());
+  bool complete = fread(h_population.data(), sizeof(Gene), h_population.size(), file) == h_population.size()
+               && fread(h_ratings.data(), sizeof(double), h_ratings.size(), file) == h_ratings.size()
+               && fread(h_ranking.data(), sizeof(unsigned), h_ranking.size(), file) == h_ranking.size();
+  fclose(file);
+  if(!complete) {
+    throw std::runtime_error(filename + " is truncated");
   }
+  // Each member starts in the slot matching its index
+  Kokkos::deep_copy(population, h_population);
+  Kokkos::deep_copy(population_slots(Kokkos::make_pair(0u, popSize)), population);
+  Kokkos::deep_copy(ratings_, h_ratings);
+  Kokkos::deep_copy(ranking(), h_ranking);
 
-  // Get a host mirror of the device data
-  auto h_current_population = Kokkos::create_mirror_view(current_population_);
+  generation = header.generation;
+  last_improvement_ = header.last_improvement;
+  best_member_ = header.best_member;
+  min_rating_ = header.min_rating;
+  best_rating_ = header.best_rating;
+}
 
-  // Get a greedy solution
-  unsigned i=0;
-  if constexpr(current_population_.rank == 2) {
-    i++;
-    auto greed = Kokkos::subview(h_current_population, 0, Kokkos::ALL());
-    runner_.greedy(greed);
+template<class Runner, class Crossover, class Selection>
+auto Genetic<Runner, Crossover, Selection>::member_of(const typename Runner::ViewType& view, unsigned i) {
+  if constexpr(Runner::ViewType::rank == 2) {
+    return Kokkos::subview(view, i, Kokkos::ALL());
   }
+  else {
+    return Kokkos::subview(view, i, Kokkos::ALL(), Kokkos::ALL());
+  }
+}
 
-  // Populate the host mirror
-  for(; i<popSize; i++) {
-    // Randomly permute the integers
-    std::shuffle(ints.begin(), ints.end(), rng_);
+template<class Runner, class Crossover, class Selection>
+auto Genetic<Runner, Crossover, Selection>::get_population_member(unsigned i, bool current) const {
+  return member_of(population_, current ? members_(i) : next_members_(i));
+}
 
-    // Assign them to the host mirror
-    if constexpr(current_population_.rank == 2) {
-      for(unsigned j=0; j<current_population_.extent(1); j++) {
-        h_current_population(i,j) = ints[j];
-      }
+template<class Runner, class Crossover, class Selection>
+auto Genetic<Runner, Crossover, Selection>::population_slots(Kokkos::pair<unsigned, unsigned> slots) const {
+  if constexpr(Runner::ViewType::rank == 2) {
+    return Kokkos::subview(population_, slots, Kokkos::ALL());
+  }
+  else {
+    return Kokkos::subview(population_, slots, Kokkos::ALL(), Kokkos::ALL());
+  }
+}
+
+// Copies the members out of their slots into a view indexed by member
+template<class Runner, class Crossover, class Selection>
+typename Runner::ViewType Genetic<Runner, Crossover, Selection>::gather_members() const {
+  unsigned popSize = members_.extent(0);
+  auto population = runner_.make_initial_population(popSize);
+  Kokkos::parallel_for("Gather members", popSize, KOKKOS_CLASS_LAMBDA (unsigned i) {
+    auto src = genetic::make_genes(get_population_member(i));
+    auto dst = genetic::make_genes(member_of(population, i));
+    for(unsigned k=0; k<dst.size(); k++) {
+      dst(k) = src(k);
     }
-    else {
-      unsigned val = 0;
-      for(unsigned j=0; j<current_population_.extent(1); j++) {
-        for(unsigned k=0; k<current_population_.extent(2); k++) {
-          h_current_population(i,j,k) = ints[val];
-          val++;
+  });
+  return population;
+}
+
+// Fills every member with its own random permutation of the genes, one
+// Fisher-Yates shuffle per member on the device.  Runners whose device
+// handle provides seed_member choose the genes themselves.
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::make_initial_population(unsigned popSize) {
+  Kokkos::parallel_for("Initial population", popSize, KOKKOS_CLASS_LAMBDA (unsigned i) {
+    using genetic::swap;
+    auto genes = genetic::make_genes(get_population_member(i));
+    with_generator(i, genetic::RandomOperation::initialize, [&](auto& gen) {
+      using Generator = std::remove_reference_t<decltype(gen)>;
+      if constexpr(has_seed_member<typename Runner::DeviceHandle, decltype(genes), Generator>::value) {
+        handle_.seed_member(genes, gen);
+      }
+      else {
+        unsigned ngenes = genes.size();
+        for(unsigned k=0; k<ngenes; k++) {
+          genes(k) = k;
+        }
+        for(unsigned k=ngenes; k>1; k--) {
+          swap(genes(k-1), genes(gen.rand(k)));
         }
       }
-    }
+    });
+  });
+
+  // Start the mappings from a greedy solution
+  if constexpr(Runner::ViewType::rank == 2) {
+    runner_.greedy(Kokkos::subview(best_host_, 0, Kokkos::ALL()));
+    Kokkos::deep_copy(best_device_, best_host_);
+    Kokkos::deep_copy(population_slots(Kokkos::make_pair(0u, 1u)), best_device_);
   }
 
-  // Copy data to device
-  Kokkos::deep_copy(current_population_, h_current_population);
+  // Block until the population is complete since the next step rates it
+  Kokkos::fence();
 }
 
-template<class Runner>
-void Genetic<Runner>::rate_population() {
-  unsigned popSize = current_population_.extent(0);
-  Kokkos::parallel_for("rate population", popSize, KOKKOS_CLASS_LAMBDA(int i) {
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::rate_population(unsigned nmembers) {
+  if(team_rating_) {
+    // One team rates each member, which keeps the hardware busy when the 
+    // population is small
+    using Policy = Kokkos::TeamPolicy<>;
+    Policy policy(nmembers, Kokkos::AUTO, Kokkos::AUTO);
+    policy.set_scratch_size(0, Kokkos::PerTeam(handle_.team_scratch_size()));
+    Kokkos::parallel_for("team rate population", policy, KOKKOS_CLASS_LAMBDA(const Policy::member_type& team) {
+      unsigned i = team.league_rank();
+      double rating = handle_.team_rate(team, get_population_member(i));
+      Kokkos::single(Kokkos::PerTeam(team), [&]() {
+        ratings_(i) = rating;
+      });
+    });
+    Kokkos::fence();
+    return;
+  }
+
+  Kokkos::parallel_for("rate population", nmembers, KOKKOS_CLASS_LAMBDA(int i) {
 //    bool verbose = i == 0 ? true : false; 
     bool verbose = false;
     auto member = get_population_member(i);
-    ratings_(i) = runner_.rate(member, verbose);
+    ratings_(i) = handle_.rate(member, verbose);
   });
 
   // Block until the GPU work is complete
   Kokkos::fence();
 }
 
-template<class Runner>
-void Genetic<Runner>::compute_weights() {
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::prepare_selection(unsigned eliteSize) {
   unsigned popSize = ratings_.extent(0);
 
   // Block until the GPU work is complete
   Kokkos::fence();
 
-  // Subtract the lowest score from all weights
-  Kokkos::parallel_for("compute weights", popSize, KOKKOS_CLASS_LAMBDA(int i) {
-    weights_[i] = ratings_[i] - ratings_[0];
-  });
+  // The ratings are sorted unless only the elites were selected
+  double offset;
+  if(deterministic_) {
+    genetic::CounterRNG gen(seed_, generation_, popSize, genetic::RandomOperation::selection_offset);
+    offset = gen.drand();
+  }
+  else {
+    offset = std::uniform_real_distribution<double>(0.0, 1.0)(rng_);
+  }
+  selection_.prepare(ratings_, min_rating_, popSize - eliteSize, offset);
 
-  // Block until all weights are computed since the next step uses them
+  // Block until the selection is ready since the next step uses it
   Kokkos::fence();
+}
 
-  // Compute the sum of all weights
-  double weight_sum;
-  Kokkos::parallel_reduce("Weight sum", popSize, KOKKOS_CLASS_LAMBDA (unsigned i, double& lsum ) {
-    lsum += weights_[i];
-  },weight_sum);
+// Lays out the next generation: the children come first and take the free
+// slots, and the elites follow, from worst to best, keeping their slots and
+// ratings.  The slots of the other members are free for the generation after.
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::assign_slots(unsigned eliteSize) {
+  unsigned popSize = members_.extent(0);
+  unsigned nchildren = popSize - eliteSize;
+  unsigned nslots = slot_used_.extent(0);
 
-  // Block until the sum is computed since the next step uses it
-  Kokkos::fence();
+  Kokkos::deep_copy(slot_used_, false);
+  Kokkos::parallel_for("Assign slots", popSize, KOKKOS_CLASS_LAMBDA (unsigned i) {
+    unsigned slot;
+    if(i < nchildren) {
+      slot = free_slots_(i);
+    }
+    else {
+      // The sorted ratings are indexed by rank, and the others by member
+      unsigned member = top_k_ ? elites_(i - nchildren) : permutation_(i);
+      next_ratings_(i) = ratings_(top_k_ ? member : i);
+      slot = members_(member);
+    }
+    next_members_(i) = slot;
+    slot_used_(slot) = true;
+  });
+
+  Kokkos::parallel_scan("Free slots", nslots, KOKKOS_CLASS_LAMBDA (unsigned slot, unsigned& position, const bool is_final) {
+    if(!slot_used_(slot)) {
+      if(is_final) {
+        free_slots_(position) = slot;
+      }
+      position++;
+    }
+  });
+}
+
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::breed_population(unsigned eliteSize) {
+  unsigned popSize = members_.extent(0);
+  assign_slots(eliteSize);
 
-  // Normalize the weights
-  Kokkos::parallel_for("Normalize weights", popSize, KOKKOS_CLASS_LAMBDA (unsigned i) {
-    weights_[i] /= weight_sum;
+  parallel_for_children("Breeding", popSize - eliteSize, KOKKOS_CLASS_LAMBDA (unsigned i, ScratchView scratch) {
+    make_child(i, scratch);
   });
 
-  // Block until the weights are normalized since the next step uses them
+  // Block until the breeding is complete since the next step uses the results
   Kokkos::fence();
 }
 
-template<class Runner>
-void Genetic<Runner>::breed_population(unsigned eliteSize) {
-  unsigned popSize = current_population_.extent(0);
-  unsigned breed_index_cutoff = popSize - eliteSize; // not inclusive
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::evolve_population(unsigned eliteSize, double mutationRate) {
+  unsigned popSize = members_.extent(0);
+  assign_slots(eliteSize);
 
-  Kokkos::parallel_for("Breeding", popSize, KOKKOS_CLASS_LAMBDA (unsigned i) {
-    // Breed to obtain these indices
-    if(i < breed_index_cutoff) {
-      // Get the parents
-      unsigned pid1 = get_parent();
-      unsigned pid2 = pid1;
-      while(pid2 == pid1) { // Make sure the parents are different
-        pid2 = get_parent();
-      }
-      breed(pid1, pid2, i);
-    }
-    // Copy over the elite items to the new population
-    else {
-      unsigned elite_index = permutation_(i);
-      for(unsigned j=0; j<current_population_.extent(1); j++) {
-        if constexpr(current_population_.rank == 2) {
-          next_population_(i,j) = current_population_(elite_index, j);
-        }
-        else {
-          for(unsigned k=0; k<current_population_.extent(2); k++) {
-            next_population_(i,j,k) = current_population_(elite_index, j, k);
-          }
-        }
-      }
-    }
+  // Each child only depends on the current population, so it can be bred,
+  // mutated and rated without waiting for the rest of the next generation
+  parallel_for_children("Breeding, mutation and rating", popSize - eliteSize, KOKKOS_CLASS_LAMBDA (unsigned i, ScratchView scratch) {
+    bool verbose = false;
+    make_child(i, scratch);
+    mutate(i, mutationRate);
+    next_ratings_(i) = handle_.rate(get_population_member(i, false), verbose);
   });
 
-  // Block until the breeding is complete since the next step uses the results
+  // Block until the next generation is complete since the next step uses the results
   Kokkos::fence();
 }
 
-template<class Runner>
-unsigned Genetic<Runner>:: get_parent() const {
-  // Get a random number between 0 and 1
-  auto gen = pool_.get_state();
-  double r = gen.drand();
-  pool_.free_state(gen);
-
-  // Determine which population member has been randomly chosen
-  double sum = 0.0;
-  unsigned parent = 0;
-  for(unsigned i=0; i<weights_.extent(0); i++) {
-    sum += weights_[i];
-    if(r < sum) {
-      parent = i;
-      break;
+// Calls functor(i, scratch) for each child i of the next generation.  The
+// teams only exist to give each thread its own scratch array for breed.
+template<class Runner, class Crossover, class Selection>
+template<class Functor>
+void Genetic<Runner, Crossover, Selection>::parallel_for_children(const std::string& label, unsigned nchildren, const Functor& functor) {
+  using Policy = Kokkos::TeamPolicy<>;
+  unsigned ngenes = population_.size() / population_.extent(0);
+  size_t bytes = ScratchView::shmem_size(ngenes);
+  int level = bytes <= size_t(Policy::scratch_size_max(0)) ? 0 : 1;
+
+  auto kernel = KOKKOS_LAMBDA (const Policy::member_type& team) {
+    unsigned i = team.league_rank()*team.team_size() + team.team_rank();
+    if(i >= nchildren) return;
+    ScratchView scratch(team.thread_scratch(level), ngenes);
+    functor(i, scratch);
+  };
+  int team_size = Policy(1, 1).set_scratch_size(level, Kokkos::PerThread(bytes))
+                              .team_size_recommended(kernel, Kokkos::ParallelForTag());
+  Policy policy((nchildren + team_size - 1) / team_size, team_size);
+  policy.set_scratch_size(level, Kokkos::PerThread(bytes));
+  Kokkos::parallel_for(label, policy, kernel);
+}
+
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::make_child(unsigned child_index, ScratchView scratch) const {
+  // Get the parents
+  unsigned pid1, pid2;
+  with_generator(child_index, genetic::RandomOperation::select, [&](auto& gen) {
+    pid1 = member_at(selection_.select(child_index, true, gen));
+    pid2 = pid1;
+    // Make sure the parents are different, unless the selection keeps 
+    // choosing the same member
+    for(unsigned attempt=0; pid2 == pid1 && attempt < 100; attempt++) {
+      pid2 = member_at(selection_.select(child_index, false, gen));
     }
+  });
+  breed(pid1, pid2, child_index, scratch);
+}
+
+// Calls functor with a generator for the given member and operation.  In
+// deterministic mode the generator is a counter-based stream, so the numbers
+// drawn do not depend on the thread that draws them.
+template<class Runner, class Crossover, class Selection>
+template<class Functor>
+void Genetic<Runner, Crossover, Selection>::with_generator(unsigned member, genetic::RandomOperation op, Functor functor) const {
+  if(deterministic_) {
+    genetic::CounterRNG gen(seed_, generation_, member, op);
+    functor(gen);
+  }
+  else {
+    auto gen = pool_.get_state();
+    functor(gen);
+    pool_.free_state(gen);
   }
-  return permutation_(parent);
 }
 
-template<class Runner>
-void Genetic<Runner>::breed(unsigned mom_index, unsigned dad_index, unsigned child_index) const {
-  using genetic::find;
+// Maps an index into the ratings to the population member it rates
+template<class Runner, class Crossover, class Selection>
+unsigned Genetic<Runner, Crossover, Selection>::member_at(unsigned rating_index) const {
+  return top_k_ ? rating_index : permutation_(rating_index);
+}
 
-  // Get the parent and child population members
-  auto mom = get_population_member(mom_index);
-  auto dad = get_population_member(dad_index);
-  auto child = get_population_member(child_index, false);
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::breed(unsigned mom_index, unsigned dad_index, unsigned child_index,
+                                       ScratchView scratch) const {
+  auto mom = genetic::make_genes(get_population_member(mom_index));
+  auto dad = genetic::make_genes(get_population_member(dad_index));
+  auto child = genetic::make_genes(get_population_member(child_index, false));
 
-  // Determine which genes are carried over from the mom
-  unsigned ngenes = current_population_.extent(current_population_.rank-1);
-  auto gen = pool_.get_state();
-  unsigned start_index = gen.rand(ngenes+1);
-  unsigned end_index = start_index;
-  while(end_index == start_index || Kokkos::abs((int)end_index - (int)start_index) >= ngenes) {
-    end_index = gen.rand(ngenes+1);
-  }
-  pool_.free_state(gen);
-  if(end_index < start_index) {
-    genetic::swap(start_index, end_index);
-  }
+  with_generator(child_index, genetic::RandomOperation::crossover, [&](auto& gen) {
+    Crossover::breed(mom, dad, child, gen, scratch);
+  });
+}
 
-  // Copy those timeslots to the child
-  if constexpr(current_population_.rank == 2) {
-    for(unsigned i=start_index; i<end_index; i++) {
-      child(i) = mom(i);
-    }
-  }
-  else {
-    for(unsigned i=0; i<child.extent(0); i++) {
-      for(unsigned j=start_index; j<end_index; j++) {
-        child(i, j) = mom(i, j);
-      }
-    }
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::mutate_population(unsigned eliteSize, double mutationRate) {
+  unsigned popSize = members_.extent(0);
+
+  // The elites are never mutated, so their ratings stay valid
+  Kokkos::parallel_for("Mutations", popSize - eliteSize, KOKKOS_CLASS_LAMBDA(unsigned p) {
+    mutate(p, mutationRate);
+  });
+
+  // Block until the mutations are complete since the next step uses the results
+  Kokkos::fence();
+}
+
+// Swaps each gene with another gene in the same row, or anywhere in the
+// member when the runner's mutate_within_rows is false, with probability
+// mutationRate.  Rather than drawing a number for every gene, the gaps
+// between mutated genes are drawn from the geometric distribution, so the
+// whole member needs a single generator state.  If the runner rejects the
+// swap, a few more partners are drawn before the gene is left alone.
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::mutate(unsigned p, double mutationRate) const {
+  using genetic::swap;
+  if(mutationRate <= 0.0) return;
+
+  auto next = genetic::make_genes(get_population_member(p, false));
+  unsigned ngenes = next.size();
+  unsigned ncols = population_.extent(population_.rank-1);
+  unsigned nrows = ngenes / ncols;
+  bool within_rows = true;
+  if constexpr(has_mutate_within_rows<typename Runner::DeviceHandle>::value) {
+    within_rows = handle_.mutate_within_rows();
   }
 
-  // Fill in the gaps with dad's info
-  Kokkos::pair<size_t, size_t> mom_indices(start_index, end_index);
-  if constexpr(current_population_.rank == 2) {
-    auto mom_genes = Kokkos::subview(mom, mom_indices);
-    for(unsigned i=0; i<child.extent(0); i++) {
-      // Skip the mom's indices
-      if (i >= start_index && i < end_index) continue;
-      // Determine whether the dad's value is already in child
-      unsigned current_index = i, new_index;
-      while(find(mom_genes, dad(current_index), new_index)) {
-        current_index = new_index + start_index;
+  constexpr unsigned max_attempts = 8;
+
+  double log_keep = Kokkos::log1p(-mutationRate);
+  with_generator(p, genetic::RandomOperation::mutate, [&](auto& gen) {
+    double skip = Kokkos::floor(Kokkos::log(1.0 - gen.drand()) / log_keep);
+    for(double k=skip; k<ngenes; k+=skip+1) {
+      // Genes are flattened column by column
+      unsigned row = unsigned(k) % nrows, col = unsigned(k) / nrows;
+
+      // Swap the element with another in the same row, or anywhere in the
+      // member if the runner arranges the rows itself
+      unsigned k1 = col*nrows + row;
+      for(unsigned attempt=0; attempt<max_attempts; attempt++) {
+        unsigned k2 = k1;
+        while(k2 == k1 || handle_.out_of_bounds(next(k2))) {
+          k2 = within_rows ? gen.rand(ncols)*nrows + row : gen.rand(ngenes);
+        }
+        bool accepted = true;
+        if constexpr(has_accepts_swap<typename Runner::DeviceHandle, decltype(next)>::value) {
+          accepted = handle_.accepts_swap(next, k1, k2);
+        }
+        if(accepted) {
+          swap(next(k1), next(k2));
+          break;
+        }
       }
-      child(i) = dad(current_index);
+      skip = Kokkos::floor(Kokkos::log(1.0 - gen.drand()) / log_keep);
     }
+  });
+}
+
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::rank_population() {
+  if(top_k_) {
+    select_elites();
   }
   else {
-    auto mom_genes = Kokkos::subview(mom, Kokkos::ALL(), mom_indices);
-    for(unsigned r=0; r<child.extent(0); r++) {
-      for(unsigned c=0; c<child.extent(1); c++) {
-        // Skip the mom's indices
-        if (c >= start_index && c < end_index) continue;
-        // Determine whether the dad's value is already in child
-        Kokkos::pair<size_t, size_t> current_index(r,c), new_index;
-        while(find(mom_genes, dad(current_index.first, current_index.second), new_index)) {
-          current_index.first = new_index.first;
-          current_index.second = new_index.second + start_index;
-        }
-        child(r, c) = dad(current_index.first, current_index.second);
-      }
-    }
+    sort();
   }
 }
 
-template<class Runner>
-void Genetic<Runner>::mutate_population(double mutationRate) {
-  using genetic::swap;
-  unsigned popSize = current_population_.extent(0);
-
-  // The constexpr can't live inside the device lambda
-  if constexpr(current_population_.rank == 2) {
-    Kokkos::parallel_for("Mutations", popSize, KOKKOS_CLASS_LAMBDA(unsigned p) {
-      // Don't mutate the best population member
-      if (p == popSize-1) return;
-      for(unsigned i=0; i<current_population_.extent(1); i++) {
-        auto gen = pool_.get_state();
-        if(gen.drand() < mutationRate) {
-          // Swap the element with another
-          unsigned i2 = i;
-          while(i2 == i || runner_.out_of_bounds(current_population_(p,i2))) {
-            i2 = gen.rand(current_population_.extent(1));
-          }
-          pool_.free_state(gen);
-          swap(next_population_(p,i), next_population_(p,i2));
-        }
-        else {
-          pool_.free_state(gen);
-        }
-      }
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>:: sort() {
+  // The bin sort places equal ratings in whichever order the threads reach
+  // them, so deterministic runs sort by rating and index instead
+  if(deterministic_) {
+    unsigned popSize = ratings_.extent(0);
+    auto order = permutation_;
+    auto sorted = sorted_ratings_;
+    Kokkos::parallel_for("Identity permutation", popSize, KOKKOS_LAMBDA (unsigned i) {
+      order(i) = i;
     });
-  }
-  else {
-    Kokkos::parallel_for("Mutations", popSize, KOKKOS_CLASS_LAMBDA(unsigned p) {
-      // Don't mutate the best population member
-      if (p == popSize-1) return;
-      for(unsigned i=0; i<current_population_.extent(1); i++) {
-        for(unsigned j=0; j<current_population_.extent(2); j++) {
-          auto gen = pool_.get_state();
-          if(gen.drand() < mutationRate) {
-            // Swap the element with another slot
-            unsigned j2 = j;
-            while(j2 == j || runner_.out_of_bounds(current_population_(p,i,j2))) {
-              j2 = gen.rand(current_population_.extent(2));
-            }
-            pool_.free_state(gen);
-            swap(next_population_(p,i,j), next_population_(p,i,j2));
-          }
-          else {
-            pool_.free_state(gen);
-          }
-        }
-      }
+    sort_by_rating(order);
+    auto ratings = ratings_;
+    Kokkos::parallel_for("Permute ratings", popSize, KOKKOS_LAMBDA (unsigned i) {
+      sorted(i) = ratings(order(i));
     });
+    std::swap(ratings_, sorted_ratings_);
+    Kokkos::deep_copy(min_rating_, Kokkos::subview(ratings_, 0));
+    Kokkos::deep_copy(best_rating_, Kokkos::subview(ratings_, popSize-1));
+    Kokkos::deep_copy(best_member_, Kokkos::subview(permutation_, popSize-1));
+    printf("%.17g\n", best_rating_);
+    return;
   }
 
-  // Block until the mutations are complete since the next step uses the results
-  Kokkos::fence();
-}
-
-template<class Runner>
-void Genetic<Runner>:: sort() {
   // Kokkos uses a bin sort which requires the minimum and maximum elements of the array
   using KeyViewType = Kokkos::View<double*>;
   using BinOp = Kokkos::BinOp1D<KeyViewType>;
@@ -385,22 +875,217 @@ void Genetic<Runner>:: sort() {
   bin_sort.create_permute_vector();
   bin_sort.sort(ratings_);
   permutation_ = bin_sort.get_permute_vector();
+  min_rating_ = min;
+  best_rating_ = max;
+  Kokkos::deep_copy(best_member_, Kokkos::subview(permutation_, ratings_.extent(0)-1));
   printf("%.17g\n", max);
 }
 
-template<class Runner>
-auto Genetic<Runner>::get_best_member() {
-  unsigned best_pop_subscript;
-  unsigned popSize = permutation_.extent(0);
-  Kokkos::deep_copy(best_pop_subscript, Kokkos::subview(permutation_, popSize-1));
-  auto h_population = Kokkos::create_mirror_view(current_population_);
-  Kokkos::deep_copy(h_population, current_population_);
-  if constexpr(h_population.rank == 2) {
-    return Kokkos::subview(h_population, best_pop_subscript, Kokkos::ALL());
+// Finds the elites without sorting the whole population.  The ratings are
+// binned into eliteSize bins, and only the members in the bins that can hold
+// an elite are sorted.
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::select_elites() {
+  using Reducer = Kokkos::MinMaxLoc<double, unsigned>;
+  unsigned popSize = ratings_.extent(0);
+  unsigned eliteSize = elites_.extent(0);
+
+  // Find the lowest and highest ratings in a single pass
+  typename Reducer::value_type bounds;
+  Kokkos::parallel_reduce("Rating bounds", popSize, KOKKOS_CLASS_LAMBDA (unsigned i, typename Reducer::value_type& lbounds) {
+    if(ratings_(i) < lbounds.min_val) {
+      lbounds.min_val = ratings_(i);
+      lbounds.min_loc = i;
+    }
+    if(ratings_(i) > lbounds.max_val) {
+      lbounds.max_val = ratings_(i);
+      lbounds.max_loc = i;
+    }
+  }, Reducer(bounds));
+  min_rating_ = bounds.min_val;
+  best_rating_ = bounds.max_val;
+  best_member_ = bounds.max_loc;
+  printf("%.17g\n", bounds.max_val);
+  if(eliteSize == 0) return;
+
+  // Count the ratings in each bin
+  unsigned nbins = eliteSize;
+  double min = bounds.min_val;
+  double width = (bounds.max_val - bounds.min_val) / nbins;
+  Kokkos::deep_copy(bin_counts_, 0);
+  Kokkos::parallel_for("Rating histogram", popSize, KOKKOS_CLASS_LAMBDA (unsigned i) {
+    Kokkos::atomic_increment(&bin_counts_(get_bin(ratings_(i), min, width, nbins)));
+  });
+  auto h_bin_counts = Kokkos::create_mirror_view_and_copy(Kokkos::HostSpace(), bin_counts_);
+
+  // Find the lowest bin that holds an elite
+  unsigned threshold = nbins;
+  for(unsigned count = 0; count < eliteSize; ) {
+    threshold--;
+    count += h_bin_counts(threshold);
+  }
+
+  // Gather the members in the top bins
+  unsigned ncandidates;
+  Kokkos::parallel_scan("Gather elite candidates", popSize, KOKKOS_CLASS_LAMBDA (unsigned i, unsigned& position, const bool is_final) {
+    if(get_bin(ratings_(i), min, width, nbins) >= threshold) {
+      if(is_final) {
+        candidates_(position) = i;
+        candidate_ratings_(position) = ratings_(i);
+      }
+      position++;
+    }
+  }, ncandidates);
+
+  // Sort the candidates by rating
+  double candidate_min;
+  Kokkos::parallel_reduce("Candidate minimum", ncandidates, KOKKOS_CLASS_LAMBDA (unsigned i, double& lmin) {
+    lmin = candidate_ratings_(i) < lmin ? candidate_ratings_(i) : lmin;
+  }, Kokkos::Min<double>(candidate_min));
+  if(deterministic_) {
+    sort_by_rating(Kokkos::subview(candidates_, Kokkos::make_pair(0u, ncandidates)));
+  }
+  else if(bounds.max_val > candidate_min) {
+    auto keys = Kokkos::subview(candidate_ratings_, Kokkos::make_pair(0u, ncandidates));
+    auto values = Kokkos::subview(candidates_, Kokkos::make_pair(0u, ncandidates));
+    using KeyViewType = decltype(keys);
+    using BinOp = Kokkos::BinOp1D<KeyViewType>;
+    BinOp bin_op(ncandidates, candidate_min, bounds.max_val);
+    Kokkos::BinSort<KeyViewType, BinOp> bin_sort(keys, bin_op, true);
+    bin_sort.create_permute_vector();
+    bin_sort.sort(values);
+  }
+
+  // The elites are the best of the candidates, from worst to best
+  unsigned offset = ncandidates - eliteSize;
+  Kokkos::parallel_for("Copy elites", eliteSize, KOKKOS_CLASS_LAMBDA (unsigned i) {
+    elites_(i) = candidates_(offset + i);
+  });
+
+  // Ties for the best rating are resolved by the sort rather than the reduction
+  if(deterministic_) {
+    Kokkos::deep_copy(best_member_, Kokkos::subview(elites_, eliteSize-1));
+  }
+
+  // Block until the elites are known since the next step uses them
+  Kokkos::fence();
+}
+
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::sort_by_rating(Kokkos::View<unsigned*> indices) const {
+  Kokkos::sort(Kokkos::DefaultExecutionSpace(), indices, RatingOrder{ratings_});
+}
+
+template<class Runner, class Crossover, class Selection>
+unsigned Genetic<Runner, Crossover, Selection>::get_bin(double rating, double min, double width, unsigned nbins) {
+  if(width <= 0.0) {
+    return nbins-1;
+  }
+  unsigned bin = (rating - min) / width;
+  return bin < nbins ? bin : nbins-1;
+}
+
+// Returns a host copy of the best member, which stays valid until the next run
+template<class Runner, class Crossover, class Selection>
+auto Genetic<Runner, Crossover, Selection>::get_best_member() {
+  if(writers_->snapshot.valid()) {
+    writers_->snapshot.wait();
+  }
+  copy_best_member();
+  return host_best_member();
+}
+
+template<class Runner, class Crossover, class Selection>
+auto Genetic<Runner, Crossover, Selection>::host_best_member() const {
+  if constexpr(best_host_.rank == 2) {
+    return Kokkos::subview(best_host_, 0, Kokkos::ALL());
   }
   else {
-    return Kokkos::subview(h_population, best_pop_subscript, Kokkos::ALL(), Kokkos::ALL());
+    return Kokkos::subview(best_host_, 0, Kokkos::ALL(), Kokkos::ALL());
+  }
+}
+
+// Copies only the best member to the host rather than the whole population
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::copy_best_member() {
+  unsigned slot;
+  Kokkos::deep_copy(slot, Kokkos::subview(members_, best_member_));
+  Kokkos::deep_copy(best_device_, population_slots(Kokkos::make_pair(slot, slot+1)));
+  Kokkos::deep_copy(best_host_, best_device_);
+}
+
+// Records the best member on a writer thread, overlapped with the next generations
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::snapshot(const std::string& filename) {
+  // The writer may still be reading the buffer for the previous snapshot
+  if(writers_->snapshot.valid()) {
+    writers_->snapshot.wait();
   }
+  copy_best_member();
+  auto best = host_best_member();
+  Runner& runner = runner_;
+  writers_->snapshot = std::async(std::launch::async, [&runner, filename, best]() {
+    runner.record(filename, best);
+  }).share();
+}
+
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::set_fused(bool fused) {
+  fused_ = fused;
+}
+
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::set_top_k_elites(bool top_k) {
+  top_k_ = top_k;
+}
+
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::set_team_rating(bool team_rating) {
+  team_rating_ = team_rating;
+}
+
+// Gives every (generation, member, operation) its own counter-based random
+// stream, so a given seed produces the same run on any number of threads.
+// Rating with teams still sums the theme penalties in a backend-dependent order.
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::set_deterministic(bool deterministic) {
+  deterministic_ = deterministic;
+}
+
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::set_time_limit(double seconds) {
+  time_limit_ = seconds;
+}
+
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::set_target_rating(double rating) {
+  target_rating_ = rating;
+}
+
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::set_stall_limit(unsigned generations) {
+  stall_limit_ = generations;
+}
+
+template<class Runner, class Crossover, class Selection>
+void Genetic<Runner, Crossover, Selection>::set_checkpoint(const std::string& filename, unsigned interval) {
+  writers_->checkpoint_file = filename;
+  checkpoint_interval_ = interval;
+}
+
+template<class Runner, class Crossover, class Selection>
+const GeneticTimings& Genetic<Runner, Crossover, Selection>::timings() const {
+  return timings_;
+}
+
+template<class Runner, class Crossover, class Selection>
+StopReason Genetic<Runner, Crossover, Selection>::stop_reason() const {
+  return stop_reason_;
+}
+
+template<class Runner, class Crossover, class Selection>
+double Genetic<Runner, Crossover, Selection>::best_rating() const {
+  return best_rating_;
 }
 
 #endif /* GENETIC_H */
\ No newline at end of file
@@ -4,12 +4,20 @@
 #include <Kokkos_Core.hpp>
 #include "Minisymposia.hpp"
 
-class Lectures {
+// The parts of Lectures used inside kernels, without the host-only metadata
+class DeviceLectures {
 public:
-  Lectures(const std::string& filename);
   KOKKOS_FUNCTION unsigned size() const;
   KOKKOS_FUNCTION unsigned topic_cohesion_score(unsigned first, unsigned second) const;
-  KOKKOS_FUNCTION unsigned topic_cohesion_score(const Minisymposia& mini, unsigned mid, unsigned lid) const;
+  KOKKOS_FUNCTION unsigned topic_cohesion_score(const DeviceMinisymposia& mini, unsigned mid, unsigned lid) const;
+protected:
+  Kokkos::View<Theme*[3]> class_codes_;
+};
+
+class Lectures : public DeviceLectures {
+public:
+  Lectures(const std::string& filename);
+  const DeviceLectures& device_handle() const;
   const std::string& title(unsigned index) const;
   unsigned id(unsigned index) const;
   Kokkos::View<Theme*[3]>::HostMirror class_codes() const;
@@ -17,7 +25,8 @@ private:
   std::vector<unsigned> ids_;
   std::vector<std::string> titles_;
   std::vector<std::string> speakers_;
-  Kokkos::View<Theme*[3]> class_codes_;
+  // Kept so that record can run on a writer thread without touching the device
+  Kokkos::View<Theme*[3]>::HostMirror h_class_codes_;
 };
 
 #endif /* LECTURES_H */
\ No newline at end of file
@@ -7,18 +7,47 @@
 #include <fstream>
 #include <random>
 
-class Mapper {
+// The parts of Mapper used inside kernels.  It only holds device data,
+// so the genetic algorithm can copy it into every kernel launch.
+class DeviceMapper {
 public:
-  typedef Kokkos::View<unsigned**> ViewType;
-
-  Mapper(const Lectures& lectures, const Minisymposia& minisymposia, unsigned nExtraMini=0);
-  ViewType make_initial_population(unsigned popSize);
+  DeviceMapper(const DeviceLectures& lectures, const DeviceMinisymposia& minisymposia);
 
   template<class View1D>
   KOKKOS_INLINE_FUNCTION double rate(View1D mapping, bool verbose=false) const;
 
+  template<class TeamMember, class View1D>
+  KOKKOS_INLINE_FUNCTION double team_rate(const TeamMember& team, View1D mapping) const;
+  size_t team_scratch_size() const;
+
   KOKKOS_FUNCTION bool out_of_bounds(unsigned i) const;
 
+protected:
+  template<class View1D>
+  KOKKOS_INLINE_FUNCTION
+  unsigned count_full_minisymposia(View1D mapping) const;
+
+  template<class View1D>
+  KOKKOS_INLINE_FUNCTION
+  double topic_cohesion_score(View1D mapping) const;
+
+  DeviceLectures lectures_;
+  DeviceMinisymposia minisymposia_;
+  const unsigned nlect_per_mini_{5};
+};
+
+// Gene is the type of the lecture indices in a mapping; see BasicScheduler
+template<class Gene>
+class BasicMapper : public DeviceMapper {
+public:
+  typedef Kokkos::View<Gene**> ViewType;
+  typedef DeviceMapper DeviceHandle;
+
+  BasicMapper(const Lectures& lectures, const Minisymposia& minisymposia, unsigned nExtraMini=0);
+  ViewType make_initial_population(unsigned popSize);
+  unsigned ngenes() const;
+  const DeviceHandle& device_handle() const;
+
   template<class View1D>
   inline void greedy(View1D solution) const;
 
@@ -28,22 +57,15 @@ public:
 private:
   void sort();
 
-  template<class View1D>
-  KOKKOS_INLINE_FUNCTION
-  unsigned count_full_minisymposia(View1D mapping) const;
-
-  template<class View1D>
-  KOKKOS_INLINE_FUNCTION
-  double topic_cohesion_score(View1D mapping) const;
-
-  Lectures lectures_;
-  Minisymposia minisymposia_;
+  Lectures host_lectures_;
+  Minisymposia host_minisymposia_;
   unsigned nExtraMini_;
-  const unsigned nlect_per_mini_{5};
 };
 
+typedef BasicMapper<unsigned> Mapper;
+
 template<class View1D>
-double Mapper::rate(View1D mapping, bool verbose) const {
+double DeviceMapper::rate(View1D mapping, bool verbose) const {
   constexpr double fullness_weight = 1.0;
   constexpr double cohesion_weight = 5.0;
 
@@ -52,9 +74,19 @@ double Mapper::rate(View1D mapping, bool verbose) const {
   return fullness_weight*nfull + cohesion_weight*cohesion;
 }
 
+// Mappings are cheap to rate, so one thread of the team rates the whole mapping
+template<class TeamMember, class View1D>
+double DeviceMapper::team_rate(const TeamMember& team, View1D mapping) const {
+  double result;
+  Kokkos::single(Kokkos::PerTeam(team), [&](double& lresult) {
+    lresult = rate(mapping);
+  }, result);
+  return result;
+}
+
 template<class View1D>
 KOKKOS_INLINE_FUNCTION
-unsigned Mapper::count_full_minisymposia(View1D mapping) const {
+unsigned DeviceMapper::count_full_minisymposia(View1D mapping) const {
   unsigned nmini = minisymposia_.size();
   unsigned nlectures = lectures_.size();
   unsigned ngenes = mapping.extent(0);
@@ -62,7 +94,7 @@ unsigned Mapper::count_full_minisymposia(View1D mapping) const {
 
   unsigned subs = 0;
   for(unsigned i=0; i<nmini; i++) {
-    unsigned nlect_in_mini = minisymposia_[i].size();
+    unsigned nlect_in_mini = minisymposia_.nlectures(i);
     for(unsigned j=nlect_in_mini; j<nlect_per_mini_; j++) {
       if(mapping(subs) < nlectures) {
         nlect_in_mini++;
@@ -86,7 +118,7 @@ unsigned Mapper::count_full_minisymposia(View1D mapping) const {
 
 template<class View1D>
 KOKKOS_INLINE_FUNCTION
-double Mapper::topic_cohesion_score(View1D mapping) const {
+double DeviceMapper::topic_cohesion_score(View1D mapping) const {
   unsigned nmini = minisymposia_.size();
   unsigned nlectures = lectures_.size();
   unsigned ngenes = mapping.extent(0);
@@ -94,7 +126,7 @@ double Mapper::topic_cohesion_score(View1D mapping) const {
 
   unsigned subs = 0;
   for(unsigned i=0; i<nmini; i++) {
-    unsigned nlect_in_mini = minisymposia_[i].size();
+    unsigned nlect_in_mini = minisymposia_.nlectures(i);
     for(unsigned j=nlect_in_mini; j<nlect_per_mini_; j++) {
       if(mapping(subs) < nlectures) {
         score += lectures_.topic_cohesion_score(minisymposia_, i, mapping(subs));
@@ -115,10 +147,11 @@ double Mapper::topic_cohesion_score(View1D mapping) const {
   return score;
 }
 
+template<class Gene>
 template<class View1D>
-void Mapper::record(const std::string& filename, View1D mapping) const {
-  unsigned nmini = minisymposia_.size();
-  unsigned nlectures = lectures_.size();
+void BasicMapper<Gene>::record(const std::string& filename, View1D mapping) const {
+  unsigned nmini = host_minisymposia_.size();
+  unsigned nlectures = host_lectures_.size();
   unsigned ngenes = mapping.extent(0);
 
   std::ofstream fout(filename + ".md");
@@ -136,23 +169,23 @@ void Mapper::record(const std::string& filename, View1D mapping) const {
   }
   fout << "\n";
 
-  auto mini_codes = minisymposia_.class_codes();
-  auto lect_codes = lectures_.class_codes();
+  auto mini_codes = host_minisymposia_.class_codes();
+  auto lect_codes = host_lectures_.class_codes();
   unsigned subs = 0;
   for(unsigned i=0; i<nmini; i++) {
-    unsigned nlect_in_mini = minisymposia_.get(i).size();
-    fout << "|" << minisymposia_.get(i).id() << " " << minisymposia_.get(i).full_title() 
+    unsigned nlect_in_mini = host_minisymposia_.get(i).size();
+    fout << "|" << host_minisymposia_.get(i).id() << " " << host_minisymposia_.get(i).full_title() 
          << " " << mini_codes(i,0) << " " << mini_codes(i,1) << " " << mini_codes(i,2);
-    auto talks = minisymposia_.get(i).talks();
+    auto talks = host_minisymposia_.get(i).talks();
     for(unsigned j=0; j<talks.size(); j++) {
       fout << "|" << talks[j];
     }
     for(unsigned j=talks.size(); j<nlect_per_mini_; j++) {
       unsigned lid = mapping(subs);
       if(lid < nlectures) {
-        fout << "|" << lectures_.id(lid) << " " << lectures_.title(lid) << " " << lect_codes(lid,0)
+        fout << "|" << host_lectures_.id(lid) << " " << host_lectures_.title(lid) << " " << lect_codes(lid,0)
              << " " << lect_codes(lid,1) << " " << lect_codes(lid,2);
-        fout2 << minisymposia_.get(i).id() << "," << lectures_.id(lid) << "\n";
+        fout2 << host_minisymposia_.get(i).id() << "," << host_lectures_.id(lid) << "\n";
       }
       else {
         fout << "| ";
@@ -167,9 +200,9 @@ void Mapper::record(const std::string& filename, View1D mapping) const {
     for(unsigned j=0; j<nlect_per_mini_; j++) {
       unsigned lid = mapping(subs+j);
       if(lid < nlectures) {
-        fout << "|" << lectures_.id(lid) << " " << lectures_.title(lid) << " " << lect_codes(lid,0)
+        fout << "|" << host_lectures_.id(lid) << " " << host_lectures_.title(lid) << " " << lect_codes(lid,0)
              << " " << lect_codes(lid,1) << " " << lect_codes(lid,2);
-        fout2 << "Contributed Lecture " << i+1 << "," << lectures_.id(lid) << "\n";
+        fout2 << "Contributed Lecture " << i+1 << "," << host_lectures_.id(lid) << "\n";
       }
       else {
         fout << "| ";
@@ -179,10 +212,11 @@ void Mapper::record(const std::string& filename, View1D mapping) const {
   }
 }
 
+template<class Gene>
 template<class View1D>
-void Mapper::greedy(View1D solution) const {
-  unsigned nlectures = lectures_.size();
-  unsigned nmini = minisymposia_.size();
+void BasicMapper<Gene>::greedy(View1D solution) const {
+  unsigned nlectures = host_lectures_.size();
+  unsigned nmini = host_minisymposia_.size();
   unsigned ngenes = solution.extent(0);
   std::vector<unsigned> unused_indices(nlectures);
   std::iota(unused_indices.begin(), unused_indices.end(), 0);
@@ -191,8 +225,8 @@ void Mapper::greedy(View1D solution) const {
     solution[i] = ngenes;
   }
 
-  auto lecture_codes = lectures_.class_codes();
-  auto mini_codes = minisymposia_.class_codes();
+  auto lecture_codes = host_lectures_.class_codes();
+  auto mini_codes = host_minisymposia_.class_codes();
 
   // Try to match everything, then take what you can get
   while(!unused_indices.empty()) {
@@ -203,7 +237,7 @@ void Mapper::greedy(View1D solution) const {
     unsigned subs = 0;
     // For each minisymposium, try to find a lecture that matches the themes
     for(unsigned i=0; i<nmini; i++) {
-      unsigned nlect_in_mini = minisymposia_.get(i).size();
+      unsigned nlect_in_mini = host_minisymposia_.get(i).size();
       for(unsigned j=nlect_in_mini; j<nlect_per_mini_; j++, subs++) {
         if(solution[subs] >= nlectures) {
           for(unsigned k=0; k<unused_indices.size(); k++) {
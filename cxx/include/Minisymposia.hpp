@@ -5,12 +5,158 @@
 #include "Rooms.hpp"
 #include "Theme.hpp"
 #include "Timeslots.hpp"
+#include "Utility.hpp"
 #include <Kokkos_Core.hpp>
 #include <ostream>
 #include <set>
 #include <vector>
 
-class Minisymposia {
+// The individual penalty terms of a schedule, as computed by rate_schedule
+struct SchedulePenalties {
+  unsigned order, gumband_time, gumband_room, oversubscribed;
+  double theme;
+  unsigned timeslot, room, priority;
+
+  KOKKOS_INLINE_FUNCTION SchedulePenalties& operator+=(const SchedulePenalties& rhs) {
+    order += rhs.order;
+    gumband_time += rhs.gumband_time;
+    gumband_room += rhs.gumband_room;
+    oversubscribed += rhs.oversubscribed;
+    theme += rhs.theme;
+    timeslot += rhs.timeslot;
+    room += rhs.room;
+    priority += rhs.priority;
+    return *this;
+  }
+};
+
+// Lets Kokkos::Sum accumulate all the penalty terms in a single reduction
+namespace Kokkos {
+template<>
+struct reduction_identity<SchedulePenalties> {
+  KOKKOS_FORCEINLINE_FUNCTION static SchedulePenalties sum() {
+    return SchedulePenalties{0, 0, 0, 0, 0.0, 0, 0, 0};
+  }
+};
+}
+
+// The parts of Minisymposia needed to rate schedules.  It holds no host-only
+// metadata, so it is cheap to copy into device lambdas.
+class DeviceMinisymposia {
+public:
+  KOKKOS_FUNCTION unsigned size() const;
+
+  KOKKOS_FUNCTION unsigned id(unsigned mid) const;
+  KOKKOS_FUNCTION unsigned room_id(unsigned mid) const;
+  KOKKOS_FUNCTION unsigned priority(unsigned mid) const;
+  KOKKOS_FUNCTION unsigned nlectures(unsigned mid) const;
+  KOKKOS_FUNCTION bool is_multipart(unsigned mid) const;
+
+  KOKKOS_FUNCTION bool overlaps_participants(unsigned m1, unsigned m2) const;
+  KOKKOS_FUNCTION bool breaks_ordering(unsigned m1, unsigned m2) const;
+  unsigned get_max_penalty() const;
+  KOKKOS_FUNCTION double map_priority_penalty(unsigned nproblems) const;
+  KOKKOS_FUNCTION const Theme& class_codes(unsigned mid, unsigned cid) const;
+
+  KOKKOS_FUNCTION bool is_valid_timeslot(unsigned mid, unsigned sid) const;
+
+  KOKKOS_FUNCTION unsigned nslots() const;
+  KOKKOS_FUNCTION unsigned nrooms() const;
+
+  template<class ViewType>
+  KOKKOS_INLINE_FUNCTION double rate_schedule(ViewType schedule, 
+    unsigned& order_penalty, unsigned& gumband_time_penalty, unsigned& gumband_room_penalty,
+    unsigned& oversubscribed_penalty, double& theme_penalty, unsigned& timeslot_penalty,
+    unsigned& room_penalty, unsigned& priority_penalty, bool verbose=false,
+    bool chains_intact=false) const;
+  
+  template<class ViewType>
+  KOKKOS_INLINE_FUNCTION double rate_schedule(ViewType schedule, SchedulePenalties& penalties, 
+    bool verbose=false) const;
+
+  template<class TeamMember, class ViewType>
+  KOKKOS_INLINE_FUNCTION double team_rate_schedule(const TeamMember& team, ViewType schedule) const;
+  size_t team_scratch_size() const;
+
+  KOKKOS_FUNCTION double score(const SchedulePenalties& penalties) const;
+  // An upper bound on the rating: every chain intact and no other penalty.
+  // Chains of three or more parts always keep a gumband time penalty, so a
+  // target of 1.0 is never reached.  With many parallel rooms, a schedule
+  // without theme overlap is just as unlikely, so runs normally stop on a
+  // stall or time limit before reaching this.
+  double max_rating() const;
+
+  template<class ViewType, class PositionType>
+  KOKKOS_INLINE_FUNCTION void find_positions(ViewType schedule, PositionType positions) const;
+
+  template<class ViewType>
+  KOKKOS_INLINE_FUNCTION void repair_chains(ViewType schedule) const;
+
+  // The most rooms assign_rooms handles, which bounds its stack arrays
+  static constexpr unsigned max_assigned_rooms = 32;
+  KOKKOS_INLINE_FUNCTION double room_cost(unsigned mid, unsigned r) const;
+  template<class ViewType>
+  KOKKOS_INLINE_FUNCTION void assign_rooms(ViewType schedule, unsigned sl) const;
+
+  template<class ViewType, class PositionType>
+  KOKKOS_INLINE_FUNCTION double swap_and_rate(ViewType schedule, PositionType positions, 
+    SchedulePenalties& penalties, unsigned sl1, unsigned r1, unsigned sl2, unsigned r2) const;
+
+  KOKKOS_INLINE_FUNCTION double get_nprereqs() const { return nprereqs_; }
+protected:
+  KOKKOS_FUNCTION bool is_prereq(unsigned m1, unsigned m2) const;
+
+  template<class ViewType, class CountType>
+  KOKKOS_INLINE_FUNCTION unsigned slot_theme_score(ViewType schedule, unsigned sl, CountType counts) const;
+
+  template<class ViewType, class PositionType>
+  KOKKOS_INLINE_FUNCTION void add_cell_penalties(ViewType schedule, PositionType positions,
+    unsigned sl, unsigned r, unsigned other_sl, unsigned other_r, int sign, 
+    SchedulePenalties& penalties) const;
+
+  KOKKOS_INLINE_FUNCTION void add_prereq_penalties(unsigned m1, unsigned sl1, unsigned r1,
+    unsigned m2, unsigned sl2, unsigned r2, int sign, SchedulePenalties& penalties) const;
+
+  Kokkos::View<Theme*[3]> class_codes_;
+  // The fields of each minisymposium needed by the kernels, built by Minisymposia::compile()
+  Kokkos::View<unsigned*> ids_;
+  Kokkos::View<unsigned*> room_ids_;
+  Kokkos::View<unsigned*> priorities_;
+  Kokkos::View<unsigned*> nlectures_;
+  Kokkos::View<bool*> is_multipart_;
+  Kokkos::View<unsigned*> participant_offsets_;
+  Kokkos::View<unsigned*> participant_neighbors_;
+  Kokkos::View<unsigned*> successor_offsets_;
+  Kokkos::View<unsigned*> successors_;
+  Kokkos::View<unsigned*> prereq_offsets_;
+  Kokkos::View<unsigned*> prereq_partners_;
+  Kokkos::View<unsigned*[2]> prereq_pairs_;
+  // The parts of each multipart minisymposium in order, one chain per title
+  Kokkos::View<unsigned*> chain_offsets_;
+  Kokkos::View<unsigned*> chain_parts_;
+  Kokkos::View<unsigned**> positions_;
+  Kokkos::Experimental::UniqueToken<Kokkos::DefaultExecutionSpace, 
+    Kokkos::Experimental::UniqueTokenScope::Global> position_token_;
+  // Each minisymposium's three themes and then their three stems, numbered
+  // densely, so a timeslot's themes can be counted in a small array
+  Kokkos::View<uint16_t*[6]> theme_bins_;
+  // The number of equal pairs among each minisymposium's own theme bins
+  Kokkos::View<uint8_t*> theme_self_pairs_;
+  // One zeroed counter per theme bin for each position token
+  Kokkos::View<uint16_t**> theme_counts_;
+  double theme_total_;
+  Kokkos::View<uint32_t**> valid_timeslots_;
+  unsigned nrooms_{0};
+  unsigned nslots_{0};
+  unsigned nprereqs_;
+  // The gumband time penalty of a schedule whose chains are all intact
+  unsigned chained_gumband_time_{0};
+  unsigned max_penalty_{4};
+  unsigned min_priority_penalty_{0};
+  unsigned max_priority_penalty_{0};
+};
+
+class Minisymposia : public DeviceMinisymposia {
 public:
   Minisymposia(const std::string& filename);
   Minisymposia(const std::string& filename, const Rooms& rooms, const Timeslots& slots);
@@ -20,119 +166,96 @@ public:
 
   unsigned find(unsigned mid) const;
   
-  KOKKOS_FUNCTION unsigned size() const;
-  KOKKOS_FUNCTION const Minisymposium& operator[](unsigned i) const;
   const Minisymposium& get(unsigned i) const;
+  const DeviceMinisymposia& device_handle() const;
 
-  KOKKOS_FUNCTION bool overlaps_participants(unsigned m1, unsigned m2) const;
-  KOKKOS_FUNCTION bool breaks_ordering(unsigned m1, unsigned m2) const;
-  unsigned get_max_penalty() const;
   void set_room_penalties(const Rooms& rooms);
   void set_overlapping_participants();
   void set_prerequisites();
   void set_valid_timeslots(const Timeslots& slots);
-  KOKKOS_FUNCTION double map_priority_penalty(unsigned nproblems) const;
   void set_priorities(unsigned nslots);
   void set_priority_penalty_bounds(unsigned nslots);
   void set_overlapping_themes(unsigned nrooms, unsigned nslots);
-  KOKKOS_FUNCTION const Theme& class_codes(unsigned mid, unsigned cid) const;
+  using DeviceMinisymposia::class_codes;
   Kokkos::View<Theme*[3]>::HostMirror class_codes() const;
 
-  KOKKOS_FUNCTION bool is_valid_timeslot(unsigned mid, unsigned sid) const;
-
-  KOKKOS_FUNCTION const Timeslots& timeslots() const;
-  KOKKOS_FUNCTION const Rooms& rooms() const;
+  const Timeslots& timeslots() const;
+  const Rooms& rooms() const;
+  // The parts of each multipart minisymposium in order, as set by set_prerequisites
+  const std::vector<std::vector<unsigned>>& chains() const;
 
-  template<class ViewType>
-  KOKKOS_INLINE_FUNCTION double rate_schedule(ViewType schedule, 
-    unsigned& order_penalty, unsigned& gumband_time_penalty, unsigned& gumband_room_penalty,
-    unsigned& oversubscribed_penalty, double& theme_penalty, unsigned& timeslot_penalty,
-    unsigned& room_penalty, unsigned& priority_penalty, bool verbose=false) const;
-  
+  using DeviceMinisymposia::rate_schedule;
   template<class ViewType>
   inline std::string rate_schedule(ViewType schedule) const;
 
   friend std::ostream& operator<<(std::ostream& os, const Minisymposia& mini);
-
-  KOKKOS_INLINE_FUNCTION double get_nprereqs() const { return nprereqs_; }
 private:
-  Kokkos::View<Theme*[3]> class_codes_;
-  Kokkos::View<Minisymposium*> d_data_;
-  Kokkos::View<Minisymposium*>::HostMirror h_data_;
-  Kokkos::View<bool**> same_participants_;
-  Kokkos::View<bool**> is_prereq_;
-  Kokkos::View<double**> theme_penalties_;
-  Kokkos::View<bool**> valid_timeslots_;
+  void compile();
+
+  // Host-only metadata, such as titles and speakers
+  std::vector<Minisymposium> data_;
+  std::vector<std::vector<unsigned>> chains_;
+  // Kept so that record can run on a writer thread without touching the device
+  Kokkos::View<Theme*[3]>::HostMirror h_class_codes_;
   Rooms rooms_;
   Timeslots timeslots_;
-  unsigned nprereqs_;
-  unsigned max_penalty_{4};
-  unsigned min_priority_penalty_{0};
-  unsigned max_priority_penalty_{0};
 };
 
 template<class ViewType>
 KOKKOS_INLINE_FUNCTION 
-double Minisymposia::rate_schedule(ViewType schedule, 
+double DeviceMinisymposia::rate_schedule(ViewType schedule, 
     unsigned& order_penalty, unsigned& gumband_time_penalty, unsigned& gumband_room_penalty,
     unsigned& oversubscribed_penalty, double& theme_penalty, unsigned& timeslot_penalty,
-    unsigned& room_penalty, unsigned& priority_penalty, bool verbose) const
+    unsigned& room_penalty, unsigned& priority_penalty, bool verbose, bool chains_intact) const
 {
   unsigned nrooms = schedule.extent(1);
   unsigned nslots = schedule.extent(0);
   unsigned nmini = size();
-  // Compute the penalty related to multi-part minisymposia being out of order
-  // AMK 08.09.2023 Is this correct when they're in the same timeslot?
-  order_penalty = 0;
-  for(unsigned sl1=0; sl1<nslots; sl1++) {
-    for(unsigned r1=0; r1<nrooms; r1++) {
-      if(schedule(sl1,r1) >= nmini) continue;
-      for(unsigned sl2=sl1; sl2<nslots; sl2++) {
-        for(unsigned r2=0; r2<nrooms; r2++) {
-          if(schedule(sl2,r2) >= nmini) continue;
-          if(breaks_ordering(schedule(sl1,r1), schedule(sl2,r2))) {
-            if(verbose) {
-              auto m1 = schedule(sl1,r1);
-              auto m2 = schedule(sl2,r2);
-              printf("%i in slot %i and %i in slot %i are out of order\n", 
-                     d_data_(m1).id(), sl1, d_data_(m2).id(), sl2);
-            }
-            order_penalty++;
-          }
-        }
-      }
-    }
+  // A chain is intact when its parts fill consecutive timeslots of one room in
+  // order, which leaves only the pairs of parts that are not adjacent apart
+  if(chains_intact) {
+    order_penalty = 0;
+    gumband_time_penalty = chained_gumband_time_;
+    gumband_room_penalty = 0;
   }
-  // Compute the penalty related to multi-part minisymposia being too far away from each other
-  gumband_time_penalty = nprereqs_;
-  for(unsigned sl=0; sl<nslots-1; sl++) {
-    for(unsigned r1=0; r1<nrooms; r1++) {
-      unsigned m1 = schedule(sl,r1);
-      if(m1 >= nmini) continue;
-      for(unsigned r2=0; r2<nrooms; r2++) {
-        unsigned m2 = schedule(sl+1,r2);
-        if(m2 >= nmini) continue;
-        if(is_prereq_(m1, m2)) {
-          gumband_time_penalty--;
+  else {
+    // Find where each minisymposium is scheduled, so that the penalties between 
+    // the parts of multipart minisymposia only need to visit the prerequisite pairs
+    int token = position_token_.acquire();
+    auto positions = Kokkos::subview(positions_, token, Kokkos::ALL());
+    find_positions(schedule, positions);
+
+    // Compute the penalty related to multi-part minisymposia being out of order
+    // AMK 08.09.2023 Is this correct when they're in the same timeslot?
+    order_penalty = 0;
+    // Compute the penalty related to multi-part minisymposia being too far away from each other
+    gumband_time_penalty = nprereqs_;
+    // Compute the penalty related to multi-part minisymposia being in different rooms
+    gumband_room_penalty = nprereqs_;
+    for(unsigned i=0; i<nprereqs_; i++) {
+      // m1 is supposed to come before m2
+      unsigned m1 = prereq_pairs_(i,0);
+      unsigned m2 = prereq_pairs_(i,1);
+      if(positions(m1) == unsigned(-1) || positions(m2) == unsigned(-1)) continue;
+      unsigned sl1 = positions(m1) / nrooms, r1 = positions(m1) % nrooms;
+      unsigned sl2 = positions(m2) / nrooms, r2 = positions(m2) % nrooms;
+      if(sl2 <= sl1) {
+        if(verbose) {
+          printf("%i in slot %i and %i in slot %i are out of order\n", 
+                 id(m2), sl2, id(m1), sl1);
         }
+        order_penalty++;
       }
-    }
-  }
-  // Compute the penalty related to multi-part minisymposia being in different rooms
-  gumband_room_penalty = nprereqs_;
-  for(unsigned sl1=0; sl1<nslots; sl1++) {
-    for(unsigned r=0; r<nrooms; r++) {
-      unsigned m1 = schedule(sl1, r);
-      if(m1 >= nmini) continue;
-      for(unsigned sl2=0; sl2<nslots; sl2++) {
-        unsigned m2 = schedule(sl2, r);
-        if(m2 >= nmini) continue;
-        if(is_prereq_(m1,m2)) {
-          gumband_room_penalty--;
-        }
+      if(sl2 == sl1+1) {
+        gumband_time_penalty--;
+      }
+      if(r1 == r2) {
+        gumband_room_penalty--;
       }
     }
+    position_token_.release(token);
   }
+
   // Compute the penalty related to oversubscribed participants
   oversubscribed_penalty = 0;
   for(unsigned sl=0; sl<nslots; sl++) {
@@ -143,7 +266,7 @@ double Minisymposia::rate_schedule(ViewType schedule,
         if(overlaps_participants(schedule(sl,r1), schedule(sl,r2))) {
           if(verbose) {
             printf("%i and %i share a participant in timeslot %i\n", 
-                   d_data_(schedule(sl,r1)).id(), d_data_(schedule(sl,r2)).id(), sl+1);
+                   id(schedule(sl,r1)), id(schedule(sl,r2)), sl+1);
           }
           oversubscribed_penalty++;
         }
@@ -151,18 +274,14 @@ double Minisymposia::rate_schedule(ViewType schedule,
     }
   }
   // Compute the penalty related to theme overlap
-  theme_penalty = 0;
+  int theme_token = position_token_.acquire();
+  auto theme_counts = Kokkos::subview(theme_counts_, theme_token, Kokkos::ALL());
+  unsigned theme_score = 0;
   for(unsigned sl=0; sl<nslots; sl++) {
-    for(unsigned r=0; r<nrooms; r++) {
-      unsigned mini_index = schedule(sl,r);
-      if(mini_index >= nmini) continue;
-      for(unsigned r2=r+1; r2<nrooms; r2++) {
-        unsigned mini_index2 = schedule(sl,r2);
-        if(mini_index2 >= nmini) continue;
-        theme_penalty += theme_penalties_(r,r2);
-      }
-    }
+    theme_score += slot_theme_score(schedule, sl, theme_counts);
   }
+  position_token_.release(theme_token);
+  theme_penalty = theme_score / theme_total_;
 
   // Compute the penalty related to scheduling speakers at a time they're not available
   timeslot_penalty = 0;
@@ -170,8 +289,8 @@ double Minisymposia::rate_schedule(ViewType schedule,
     for(unsigned r=0; r<nrooms; r++) {
       unsigned mini_index = schedule(sl,r);
       if(mini_index >= nmini) continue;
-      if(!valid_timeslots_(mini_index, sl)) {
-        if(verbose) printf("%i is in invalid timeslot %i\n", d_data_(mini_index).id(), sl+1);
+      if(!is_valid_timeslot(mini_index, sl)) {
+        if(verbose) printf("%i is in invalid timeslot %i\n", id(mini_index), sl+1);
         timeslot_penalty++;
       }
     }
@@ -184,26 +303,445 @@ double Minisymposia::rate_schedule(ViewType schedule,
     for(unsigned r=0; r<nrooms; r++) {
       unsigned mini_index = schedule(sl,r);
       if(mini_index >= nmini) continue;
-      unsigned room_id = d_data_[mini_index].room_id();
+      unsigned room_id = this->room_id(mini_index);
       // This is a minisymposium with a room request
       if(room_id < nrooms) {
         if(room_id != r) {
-          if(verbose) printf("%i is in invalid room %i\n", d_data_(mini_index).id(), r);
+          if(verbose) printf("%i is in invalid room %i\n", id(mini_index), r);
           room_penalty++;
         }
       }
       // There is no room request
       else {
-        unsigned priority = d_data_[mini_index].priority();
+        unsigned priority = this->priority(mini_index);
         if(priority < r) {
           priority_penalty += pow(r-priority, 2);
         }
       }
     }
   }
-  double penalty = order_penalty + oversubscribed_penalty + room_penalty + timeslot_penalty;
-  penalty += theme_penalty + (gumband_time_penalty + gumband_room_penalty)/(double)nprereqs_ + map_priority_penalty(priority_penalty);
-  return 1 - penalty / max_penalty_;
+  SchedulePenalties penalties{order_penalty, gumband_time_penalty, gumband_room_penalty, oversubscribed_penalty,
+                              theme_penalty, timeslot_penalty, room_penalty, priority_penalty};
+  return score(penalties);
+}
+
+// Rates a schedule with a whole team.  The prerequisite pairs and the timeslots 
+// are split across the team's threads, and the rooms of each timeslot across
+// its vector lanes.  The team needs team_scratch_size() bytes of level 0 scratch.
+template<class TeamMember, class ViewType>
+KOKKOS_INLINE_FUNCTION 
+double DeviceMinisymposia::team_rate_schedule(const TeamMember& team, ViewType schedule) const {
+  using ScratchView = Kokkos::View<unsigned*, typename TeamMember::scratch_memory_space, Kokkos::MemoryUnmanaged>;
+  unsigned nrooms = schedule.extent(1);
+  unsigned nslots = schedule.extent(0);
+  unsigned nmini = size();
+
+  // Find where each minisymposium is scheduled
+  ScratchView positions(team.team_scratch(0), nmini);
+  Kokkos::parallel_for(Kokkos::TeamThreadRange(team, nmini), [&](unsigned i) {
+    positions(i) = unsigned(-1);
+  });
+  team.team_barrier();
+  Kokkos::parallel_for(Kokkos::TeamThreadRange(team, nslots*nrooms), [&](unsigned cell) {
+    unsigned mini_index = schedule(cell / nrooms, cell % nrooms);
+    if(mini_index < nmini) {
+      positions(mini_index) = cell;
+    }
+  });
+  team.team_barrier();
+
+  // Count the out of order pairs, and the pairs that satisfy the gumband constraints
+  SchedulePenalties pairs;
+  Kokkos::parallel_reduce(Kokkos::TeamThreadRange(team, nprereqs_), [&](unsigned i, SchedulePenalties& lpairs) {
+    unsigned m1 = prereq_pairs_(i,0);
+    unsigned m2 = prereq_pairs_(i,1);
+    if(positions(m1) == unsigned(-1) || positions(m2) == unsigned(-1)) return;
+    unsigned sl1 = positions(m1) / nrooms, r1 = positions(m1) % nrooms;
+    unsigned sl2 = positions(m2) / nrooms, r2 = positions(m2) % nrooms;
+    if(sl2 <= sl1) lpairs.order++;
+    if(sl2 == sl1+1) lpairs.gumband_time++;
+    if(r1 == r2) lpairs.gumband_room++;
+  }, Kokkos::Sum<SchedulePenalties>(pairs));
+
+  // The remaining penalties only involve the minisymposia within a timeslot.
+  // Each thread counts the themes of its timeslots in its own histogram.
+  int theme_token;
+  Kokkos::single(Kokkos::PerThread(team), [&](int& ltoken) {
+    ltoken = position_token_.acquire();
+  }, theme_token);
+  auto theme_counts = Kokkos::subview(theme_counts_, theme_token, Kokkos::ALL());
+  SchedulePenalties penalties;
+  Kokkos::parallel_reduce(Kokkos::TeamThreadRange(team, nslots), [&](unsigned sl, SchedulePenalties& lpenalties) {
+    SchedulePenalties slot_penalties;
+    Kokkos::parallel_reduce(Kokkos::ThreadVectorRange(team, nrooms), [&](unsigned r, SchedulePenalties& lslot) {
+      unsigned mini_index = schedule(sl,r);
+      if(mini_index >= nmini) return;
+      for(unsigned r2=r+1; r2<nrooms; r2++) {
+        unsigned mini_index2 = schedule(sl,r2);
+        if(mini_index2 >= nmini) continue;
+        lslot.oversubscribed += overlaps_participants(mini_index, mini_index2);
+      }
+      if(!is_valid_timeslot(mini_index, sl)) {
+        lslot.timeslot++;
+      }
+      unsigned room_id = this->room_id(mini_index);
+      if(room_id < nrooms) {
+        if(room_id != r) {
+          lslot.room++;
+        }
+      }
+      else {
+        unsigned priority = this->priority(mini_index);
+        if(priority < r) {
+          lslot.priority += (r-priority)*(r-priority);
+        }
+      }
+    }, Kokkos::Sum<SchedulePenalties>(slot_penalties));
+    // The theme score is summed as a whole number and scaled at the end, as in rate_schedule
+    Kokkos::single(Kokkos::PerThread(team), [&](double& ltheme) {
+      ltheme = slot_theme_score(schedule, sl, theme_counts);
+    }, slot_penalties.theme);
+    lpenalties += slot_penalties;
+  }, Kokkos::Sum<SchedulePenalties>(penalties));
+  Kokkos::single(Kokkos::PerThread(team), [&]() {
+    position_token_.release(theme_token);
+  });
+
+  penalties.theme /= theme_total_;
+  penalties.order = pairs.order;
+  penalties.gumband_time = nprereqs_ - pairs.gumband_time;
+  penalties.gumband_room = nprereqs_ - pairs.gumband_room;
+  return score(penalties);
+}
+
+template<class ViewType>
+KOKKOS_INLINE_FUNCTION 
+double DeviceMinisymposia::rate_schedule(ViewType schedule, SchedulePenalties& penalties, bool verbose) const {
+  return rate_schedule(schedule, penalties.order, penalties.gumband_time, penalties.gumband_room,
+                       penalties.oversubscribed, penalties.theme, penalties.timeslot, penalties.room,
+                       penalties.priority, verbose);
+}
+
+// Returns the sum of the topic scores of every pair of minisymposia in
+// timeslot sl.  Two themes score 1 for sharing a stem and 1 more for being
+// identical, so a pair's score is its number of equal theme bins.  Counting
+// the bins of the timeslot gives every equal pair in O(nrooms) time, and
+// each minisymposium's pairs with itself are taken back out.  The counters
+// are left zeroed.
+template<class ViewType, class CountType>
+KOKKOS_INLINE_FUNCTION 
+unsigned DeviceMinisymposia::slot_theme_score(ViewType schedule, unsigned sl, CountType counts) const {
+  unsigned nrooms = schedule.extent(1);
+  unsigned nmini = size();
+  unsigned score = 0;
+  for(unsigned r=0; r<nrooms; r++) {
+    unsigned mini_index = schedule(sl,r);
+    if(mini_index >= nmini) continue;
+    for(unsigned b=0; b<6; b++) {
+      score += counts(theme_bins_(mini_index,b))++;
+    }
+    score -= theme_self_pairs_(mini_index);
+  }
+  for(unsigned r=0; r<nrooms; r++) {
+    unsigned mini_index = schedule(sl,r);
+    if(mini_index >= nmini) continue;
+    for(unsigned b=0; b<6; b++) {
+      counts(theme_bins_(mini_index,b)) = 0;
+    }
+  }
+  return score;
+}
+
+template<class ViewType, class PositionType>
+KOKKOS_INLINE_FUNCTION 
+void DeviceMinisymposia::find_positions(ViewType schedule, PositionType positions) const {
+  unsigned nrooms = schedule.extent(1);
+  unsigned nslots = schedule.extent(0);
+  unsigned nmini = size();
+  // Minisymposia that are missing from the schedule have no position
+  for(unsigned i=0; i<nmini; i++) {
+    positions(i) = unsigned(-1);
+  }
+  for(unsigned sl=0; sl<nslots; sl++) {
+    for(unsigned r=0; r<nrooms; r++) {
+      unsigned mini_index = schedule(sl,r);
+      if(mini_index < nmini) {
+        positions(mini_index) = sl*nrooms + r;
+      }
+    }
+  }
+}
+
+// The room and priority penalties of putting minisymposium mid in room r,
+// weighted as they are in score
+KOKKOS_INLINE_FUNCTION
+double DeviceMinisymposia::room_cost(unsigned mid, unsigned r) const {
+  unsigned room_id = this->room_id(mid);
+  if(room_id < nrooms_) {
+    return room_id == r ? 0.0 : 1.0;
+  }
+  unsigned priority = this->priority(mid);
+  if(priority < r && max_priority_penalty_ > min_priority_penalty_) {
+    return (r-priority)*(r-priority) / double(max_priority_penalty_ - min_priority_penalty_);
+  }
+  return 0.0;
+}
+
+// Places the minisymposia of timeslot sl in the rooms that minimize the
+// sum of their room_cost, with the Hungarian algorithm.  The minisymposia
+// are the rows and the rooms the columns; empty cells take the rooms left
+// over.  Requires nrooms <= max_assigned_rooms.
+template<class ViewType>
+KOKKOS_INLINE_FUNCTION
+void DeviceMinisymposia::assign_rooms(ViewType schedule, unsigned sl) const {
+  constexpr unsigned N = max_assigned_rooms + 1;
+  constexpr double infinity = Kokkos::Experimental::infinity_v<double>;
+  unsigned nrooms = schedule.extent(1);
+  unsigned nmini = size();
+
+  // Rows are 1-based, with the minisymposia first
+  unsigned cells[N];
+  unsigned nrows = 0, nempty = 0;
+  for(unsigned r=0; r<nrooms; r++) {
+    if(schedule(sl,r) < nmini) {
+      cells[++nrows] = schedule(sl,r);
+    }
+  }
+  for(unsigned r=0; r<nrooms; r++) {
+    if(schedule(sl,r) >= nmini) {
+      cells[nrows + ++nempty] = schedule(sl,r);
+    }
+  }
+
+  // row_of[j] is the row assigned to room j-1, and 0 if there is none
+  double u[N], v[N], min_slack[N];
+  unsigned row_of[N], previous[N];
+  bool visited[N];
+  for(unsigned j=0; j<=nrooms; j++) {
+    u[j] = v[j] = 0.0;
+    row_of[j] = 0;
+  }
+  for(unsigned i=1; i<=nrows; i++) {
+    row_of[0] = i;
+    unsigned j0 = 0;
+    for(unsigned j=0; j<=nrooms; j++) {
+      min_slack[j] = infinity;
+      visited[j] = false;
+    }
+    // Grow alternating paths until one reaches a free room
+    do {
+      visited[j0] = true;
+      unsigned i0 = row_of[j0], j1 = 0;
+      double delta = infinity;
+      for(unsigned j=1; j<=nrooms; j++) {
+        if(visited[j]) continue;
+        double slack = room_cost(cells[i0], j-1) - u[i0] - v[j];
+        if(slack < min_slack[j]) {
+          min_slack[j] = slack;
+          previous[j] = j0;
+        }
+        if(min_slack[j] < delta) {
+          delta = min_slack[j];
+          j1 = j;
+        }
+      }
+      for(unsigned j=0; j<=nrooms; j++) {
+        if(visited[j]) {
+          u[row_of[j]] += delta;
+          v[j] -= delta;
+        }
+        else {
+          min_slack[j] -= delta;
+        }
+      }
+      j0 = j1;
+    } while(row_of[j0] != 0);
+    // Flip the path
+    do {
+      unsigned j1 = previous[j0];
+      row_of[j0] = row_of[j1];
+      j0 = j1;
+    } while(j0 != 0);
+  }
+
+  for(unsigned j=1, next_empty=nrows+1; j<=nrooms; j++) {
+    schedule(sl,j-1) = row_of[j] != 0 ? cells[row_of[j]] : cells[next_empty++];
+  }
+}
+
+// Moves the parts of each multipart minisymposium into consecutive slots of
+// the same room and into order.  Only the chains are visited, with a map of
+// where each minisymposium is, rather than every pair of cells.  The moves
+// follow the same rules as the cell scan this replaced, but are tried in
+// chain and part order rather than schedule order, so when several moves
+// compete for a cell the repaired schedule can differ from the old one.
+template<class ViewType>
+KOKKOS_INLINE_FUNCTION
+void DeviceMinisymposia::repair_chains(ViewType schedule) const {
+  unsigned nrooms = schedule.extent(1);
+  unsigned nmini = size();
+  unsigned nchains = chain_offsets_.extent(0) > 0 ? chain_offsets_.extent(0)-1 : 0;
+  if(nchains == 0) return;
+
+  int token = position_token_.acquire();
+  auto positions = Kokkos::subview(positions_, token, Kokkos::ALL());
+  find_positions(schedule, positions);
+
+  // Swaps the contents of two cells, keeping the positions up to date
+  auto swap_cells = [&](unsigned p1, unsigned p2) {
+    unsigned m1 = schedule(p1 / nrooms, p1 % nrooms);
+    unsigned m2 = schedule(p2 / nrooms, p2 % nrooms);
+    genetic::swap(schedule(p1 / nrooms, p1 % nrooms), schedule(p2 / nrooms, p2 % nrooms));
+    if(m1 < nmini) positions(m1) = p2;
+    if(m2 < nmini) positions(m2) = p1;
+  };
+
+  // Move each part to the slot after an earlier part of the same 
+  // minisymposium, in the same room, when both moves respect the timeslots
+  for(unsigned c=0; c<nchains; c++) {
+    for(unsigned i=chain_offsets_(c); i<chain_offsets_(c+1); i++) {
+      for(unsigned j=chain_offsets_(c); j<chain_offsets_(c+1); j++) {
+        unsigned m1 = chain_parts_(i), m2 = chain_parts_(j);
+        if(positions(m1) == unsigned(-1) || positions(m2) == unsigned(-1)) continue;
+        unsigned sl1 = positions(m1) / nrooms, r1 = positions(m1) % nrooms;
+        unsigned sl2 = positions(m2) / nrooms;
+        if(sl2 <= sl1) continue;
+        if(!is_valid_timeslot(m2, sl1+1)) continue;
+        unsigned displaced = schedule(sl1+1, r1);
+        if(displaced < nmini && !is_valid_timeslot(displaced, sl2)) continue;
+        swap_cells(positions(m2), (sl1+1)*nrooms + r1);
+      }
+    }
+  }
+
+  // Give each part the earliest slot held by it and the parts after it
+  for(unsigned c=0; c<nchains; c++) {
+    for(unsigned i=chain_offsets_(c); i<chain_offsets_(c+1); i++) {
+      for(unsigned j=i+1; j<chain_offsets_(c+1); j++) {
+        unsigned m1 = chain_parts_(i), m2 = chain_parts_(j);
+        if(positions(m1) == unsigned(-1) || positions(m2) == unsigned(-1)) continue;
+        if(positions(m2) / nrooms < positions(m1) / nrooms) {
+          swap_cells(positions(m1), positions(m2));
+        }
+      }
+    }
+  }
+  position_token_.release(token);
+}
+
+// Swaps two cells of a schedule and updates its cached penalties to match.
+// Only the terms involving the two cells are recomputed, which costs 
+// O(nrooms + the number of other parts of the two minisymposia).
+// positions must hold the result of find_positions and is kept up to date.
+template<class ViewType, class PositionType>
+KOKKOS_INLINE_FUNCTION 
+double DeviceMinisymposia::swap_and_rate(ViewType schedule, PositionType positions, 
+  SchedulePenalties& penalties, unsigned sl1, unsigned r1, unsigned sl2, unsigned r2) const
+{
+  unsigned nrooms = schedule.extent(1);
+  unsigned nmini = size();
+  if(sl1 == sl2 && r1 == r2) return score(penalties);
+
+  // The theme penalty of the one or two timeslots involved is recounted
+  int theme_token = position_token_.acquire();
+  auto theme_counts = Kokkos::subview(theme_counts_, theme_token, Kokkos::ALL());
+  int theme_delta = 0;
+
+  // Remove the contributions of both cells, counting the pair between them only once
+  for(int sign=-1; sign<=1; sign+=2) {
+    add_cell_penalties(schedule, positions, sl1, r1, sl2, r2, sign, penalties);
+    add_cell_penalties(schedule, positions, sl2, r2, sl1, r1, sign, penalties);
+    theme_delta += sign*int(slot_theme_score(schedule, sl1, theme_counts));
+    if(sl2 != sl1) {
+      theme_delta += sign*int(slot_theme_score(schedule, sl2, theme_counts));
+    }
+    unsigned m1 = schedule(sl1,r1);
+    unsigned m2 = schedule(sl2,r2);
+    if(m1 < nmini && m2 < nmini) {
+      add_prereq_penalties(m1, sl1, r1, m2, sl2, r2, sign, penalties);
+      if(sl1 == sl2) {
+        penalties.oversubscribed += sign*overlaps_participants(m1, m2);
+      }
+    }
+
+    // Swap the cells, then add the contributions back in
+    if(sign < 0) {
+      genetic::swap(schedule(sl1,r1), schedule(sl2,r2));
+      if(m1 < nmini) positions(m1) = sl2*nrooms + r2;
+      if(m2 < nmini) positions(m2) = sl1*nrooms + r1;
+    }
+  }
+  position_token_.release(theme_token);
+  penalties.theme += theme_delta / theme_total_;
+  return score(penalties);
+}
+
+// Adds sign times the penalties involving the minisymposium in cell (sl,r),
+// skipping any pair with the cell (other_sl, other_r)
+template<class ViewType, class PositionType>
+KOKKOS_INLINE_FUNCTION 
+void DeviceMinisymposia::add_cell_penalties(ViewType schedule, PositionType positions,
+  unsigned sl, unsigned r, unsigned other_sl, unsigned other_r, int sign, 
+  SchedulePenalties& penalties) const
+{
+  unsigned nrooms = schedule.extent(1);
+  unsigned nmini = size();
+  unsigned mini_index = schedule(sl,r);
+  if(mini_index >= nmini) return;
+
+  // Order and gumband penalties only involve the other parts of this minisymposium
+  unsigned other_position = other_sl*nrooms + other_r;
+  for(unsigned i=prereq_offsets_(mini_index); i<prereq_offsets_(mini_index+1); i++) {
+    unsigned partner = prereq_partners_(i);
+    unsigned position = positions(partner);
+    if(position == other_position || position == unsigned(-1)) continue;
+    add_prereq_penalties(mini_index, sl, r, partner, position / nrooms, position % nrooms, sign, penalties);
+  }
+
+  // Participant penalties involve the rest of the timeslot
+  for(unsigned r2=0; r2<nrooms; r2++) {
+    if(r2 == r || (sl == other_sl && r2 == other_r)) continue;
+    unsigned mini_index2 = schedule(sl,r2);
+    if(mini_index2 >= nmini) continue;
+    penalties.oversubscribed += sign*overlaps_participants(mini_index, mini_index2);
+  }
+
+  // The remaining penalties only involve this cell
+  if(!is_valid_timeslot(mini_index, sl)) {
+    penalties.timeslot += sign;
+  }
+  unsigned room_id = this->room_id(mini_index);
+  if(room_id < nrooms) {
+    if(room_id != r) {
+      penalties.room += sign;
+    }
+  }
+  else {
+    unsigned priority = this->priority(mini_index);
+    if(priority < r) {
+      penalties.priority += sign*int((r-priority)*(r-priority));
+    }
+  }
+}
+
+// Adds sign times the order and gumband penalties between two minisymposia
+KOKKOS_INLINE_FUNCTION 
+void DeviceMinisymposia::add_prereq_penalties(unsigned m1, unsigned sl1, unsigned r1,
+  unsigned m2, unsigned sl2, unsigned r2, int sign, SchedulePenalties& penalties) const
+{
+  if(is_prereq(m2, m1)) {
+    genetic::swap(m1, m2);
+    genetic::swap(sl1, sl2);
+    genetic::swap(r1, r2);
+  }
+  else if(!is_prereq(m1, m2)) {
+    return;
+  }
+
+  // m1 must come before m2
+  if(sl2 <= sl1) penalties.order += sign;
+  if(sl2 == sl1+1) penalties.gumband_time -= sign;
+  if(r1 == r2) penalties.gumband_room -= sign;
 }
 
 template<class ViewType>
@@ -211,8 +749,9 @@ inline std::string Minisymposia::rate_schedule(ViewType schedule) const {
   Kokkos::View<unsigned*> d_penalties("penalties", 7);
   Kokkos::View<double*> d_penalty("penalty", 1);
   double score;
-  Kokkos::parallel_reduce("computing score", 1, KOKKOS_CLASS_LAMBDA (unsigned i, double& lscore) {
-    lscore = rate_schedule(schedule, d_penalties(0), d_penalties(1), d_penalties(2),
+  DeviceMinisymposia mini = device_handle();
+  Kokkos::parallel_reduce("computing score", 1, KOKKOS_LAMBDA (unsigned i, double& lscore) {
+    lscore = mini.rate_schedule(schedule, d_penalties(0), d_penalties(1), d_penalties(2),
       d_penalties(3), d_penalty(0), d_penalties(4), d_penalties(5), d_penalties(6));
   }, score);
 
@@ -2,7 +2,6 @@
 #define MINISYMPOSIUM_H
 
 #include "Speaker.hpp"
-#include <Kokkos_Core.hpp>
 #include <ostream>
 #include <string>
 #include <unordered_set>
@@ -24,20 +23,20 @@ public:
 
   bool shares_participant(const Minisymposium& m) const;
   bool comes_before(const Minisymposium& m) const;
-  KOKKOS_FUNCTION unsigned priority() const;
+  unsigned priority() const;
   const std::string& short_title() const;
   const std::string& full_title() const;
   const std::string& room() const;
-  KOKKOS_FUNCTION unsigned id() const;
-  KOKKOS_FUNCTION unsigned room_id() const;
+  unsigned id() const;
+  unsigned room_id() const;
   unsigned total_citation_count() const;
   unsigned max_citation_count() const;
   const std::vector<std::string>& talks() const;
 
   void set_priority(unsigned priority);
   void set_room_id(unsigned id);
-  KOKKOS_FUNCTION unsigned size() const;
-  KOKKOS_FUNCTION bool is_multipart() const;
+  unsigned size() const;
+  bool is_multipart() const;
 
   bool is_valid_timeslot(unsigned timeslot) const;
 
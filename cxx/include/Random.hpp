@@ -0,0 +1,85 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include "Kokkos_Core.hpp"
+#include <cstdint>
+
+namespace genetic {
+
+// What a stream of random numbers is used for
+enum class RandomOperation : uint32_t { select, crossover, mutate, selection_offset, initialize };
+
+// A counter-based generator using the Philox-4x32-10 bijection.  Each
+// (seed, generation, member, operation) tuple has its own stream, so the
+// numbers drawn never depend on which thread asks for them.  It provides
+// the parts of the Kokkos generator interface that Genetic uses.
+class CounterRNG {
+public:
+  KOKKOS_INLINE_FUNCTION CounterRNG(uint64_t seed, uint32_t generation, uint32_t member, RandomOperation op);
+
+  KOKKOS_INLINE_FUNCTION uint32_t urand();
+  KOKKOS_INLINE_FUNCTION uint64_t urand64();
+  KOKKOS_INLINE_FUNCTION uint32_t rand(uint32_t range);
+  KOKKOS_INLINE_FUNCTION double drand();
+private:
+  KOKKOS_INLINE_FUNCTION void refill();
+
+  uint32_t key_[2];
+  uint32_t counter_[4];
+  uint32_t buffer_[4];
+  unsigned next_;
+};
+
+CounterRNG::CounterRNG(uint64_t seed, uint32_t generation, uint32_t member, RandomOperation op) :
+  key_{uint32_t(seed), uint32_t(seed >> 32)},
+  counter_{0, uint32_t(op), member, generation},
+  next_(4)
+{
+
+}
+
+void CounterRNG::refill() {
+  uint32_t c[4] = {counter_[0], counter_[1], counter_[2], counter_[3]};
+  uint32_t k[2] = {key_[0], key_[1]};
+  for(unsigned round=0; round<10; round++) {
+    uint64_t p0 = uint64_t(0xD2511F53) * c[0];
+    uint64_t p1 = uint64_t(0xCD9E8D57) * c[2];
+    uint32_t next[4] = {uint32_t(p1 >> 32) ^ c[1] ^ k[0], uint32_t(p1),
+                        uint32_t(p0 >> 32) ^ c[3] ^ k[1], uint32_t(p0)};
+    for(unsigned i=0; i<4; i++) {
+      c[i] = next[i];
+    }
+    k[0] += 0x9E3779B9;
+    k[1] += 0xBB67AE85;
+  }
+  for(unsigned i=0; i<4; i++) {
+    buffer_[i] = c[i];
+  }
+  counter_[0]++;
+  next_ = 0;
+}
+
+uint32_t CounterRNG::urand() {
+  if(next_ == 4) {
+    refill();
+  }
+  return buffer_[next_++];
+}
+
+uint64_t CounterRNG::urand64() {
+  uint64_t hi = urand();
+  return (hi << 32) | urand();
+}
+
+uint32_t CounterRNG::rand(uint32_t range) {
+  return urand64() % range;
+}
+
+// Uses the top 53 bits, giving a double in [0, 1)
+double CounterRNG::drand() {
+  return (urand64() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+} // namespace genetic
+
+#endif /* RANDOM_H */
@@ -11,33 +11,76 @@
 #include <vector>
 #include <QTableWidget>
 
-class Scheduler {
+// The parts of Scheduler used inside kernels.  It only holds device data,
+// so the genetic algorithm can copy it into every kernel launch.
+class DeviceScheduler {
 public:
-  typedef Kokkos::View<unsigned***> ViewType;
-
-  Scheduler(const Minisymposia& mini);
-  ViewType make_initial_population(unsigned nschedules) const;
+  DeviceScheduler(const DeviceMinisymposia& mini);
 
   template<class View2D>
   KOKKOS_INLINE_FUNCTION double rate(View2D schedule, bool verbose=false) const;
 
-  template<class View2D>
-  KOKKOS_INLINE_FUNCTION void fix_order(View2D schedule, bool verbose=false) const;
+  template<class TeamMember, class View2D>
+  KOKKOS_INLINE_FUNCTION double team_rate(const TeamMember& team, View2D schedule) const;
+  size_t team_scratch_size() const;
 
   template<class View2D>
-  inline void record(const std::string& filename, View2D schedule) const;
+  KOKKOS_INLINE_FUNCTION void fix_order(View2D schedule, bool verbose=false) const;
 
   KOKKOS_FUNCTION bool out_of_bounds(unsigned i) const;
   KOKKOS_FUNCTION unsigned nslots() const;
   KOKKOS_FUNCTION unsigned nrooms() const;
+
+  // Must be called before the scheduler is handed to Genetic, which copies it
+  void set_room_assignment(bool assign_rooms);
+  KOKKOS_FUNCTION bool mutate_within_rows() const;
+
+  // Must be called before the scheduler is handed to Genetic, which copies it
+  void set_feasible_sampling(bool feasible_sampling);
+  template<class GenesType, class Generator>
+  KOKKOS_INLINE_FUNCTION void seed_member(const GenesType& genes, Generator& gen) const;
+  template<class GenesType>
+  KOKKOS_INLINE_FUNCTION bool accepts_swap(const GenesType& genes, unsigned k1, unsigned k2) const;
+
+protected:
+  template<class GenesType, class Generator>
+  KOKKOS_INLINE_FUNCTION unsigned free_cell(const GenesType& genes, unsigned mid, Generator& gen) const;
+
+  DeviceMinisymposia mini_;
+  // Place each timeslot's minisymposia in the optimal rooms, so the genes
+  // only decide the timeslots.  Only set when there are few enough rooms.
+  bool assign_rooms_{false};
+  // Start each minisymposium in a valid timeslot and its requested room, and
+  // only mutate it into valid timeslots
+  bool feasible_sampling_{false};
+};
+
+// Gene is the type of the minisymposium indices in a schedule.  Each schedule
+// holds nslots*nrooms of them, so uint16_t halves the memory traffic of the
+// genetic algorithm whenever genetic::fits_gene_type allows it.
+template<class Gene>
+class BasicScheduler : public DeviceScheduler {
+public:
+  typedef Kokkos::View<Gene***> ViewType;
+  typedef DeviceScheduler DeviceHandle;
+
+  BasicScheduler(const Minisymposia& mini);
+  ViewType make_initial_population(unsigned nschedules) const;
+  const DeviceHandle& device_handle() const;
+
+  template<class View2D>
+  inline void record(const std::string& filename, View2D schedule) const;
+
   void record(const std::string& filename) const;
 
 private:
-  Minisymposia mini_;
+  Minisymposia host_mini_;
 };
 
+typedef BasicScheduler<unsigned> Scheduler;
+
 template<class View2D>
-double Scheduler::rate(View2D schedule, bool verbose) const {
+double DeviceScheduler::rate(View2D schedule, bool verbose) const {
   fix_order(schedule, false);
 
   unsigned order_penalty, gumband_time_penalty, gumband_room_penalty, oversubscribed_penalty;
@@ -60,10 +103,28 @@ double Scheduler::rate(View2D schedule, bool verbose) const {
   return result;
 }
 
+template<class TeamMember, class View2D>
+double DeviceScheduler::team_rate(const TeamMember& team, View2D schedule) const {
+  // Reordering the rooms is sequential, so one thread does it for the team
+  Kokkos::single(Kokkos::PerTeam(team), [&]() {
+    fix_order(schedule, false);
+  });
+  team.team_barrier();
+  return mini_.team_rate_schedule(team, schedule);
+}
+
 template<class View2D>
-void Scheduler::fix_order(View2D schedule, bool verbose) const {
+void DeviceScheduler::fix_order(View2D schedule, bool verbose) const {
   unsigned nmini = mini_.size();
 
+  if(assign_rooms_) {
+    for(unsigned sl=0; sl<nslots(); sl++) {
+      mini_.assign_rooms(schedule, sl);
+    }
+    mini_.repair_chains(schedule);
+    return;
+  }
+
   // Sort the minisymposia in each slot based on the room priority
   // Assign minisymposia to the correct rooms if possible
   for(unsigned sl=0; sl<nslots(); sl++) {
@@ -72,19 +133,19 @@ void Scheduler::fix_order(View2D schedule, bool verbose) const {
       unsigned min_index = i;
       unsigned min_value = unsigned(-1);
       if(m1 < nmini) {
-        if(mini_[m1].room_id() == i) {
+        if(mini_.room_id(m1) == i) {
           if(verbose) {
 //            printf("Minisymposium %i is already in the correct room\n", m1);
           }
           continue;
         }
-        min_value = mini_[m1].priority();
+        min_value = mini_.priority(m1);
       }
       for(unsigned j=i+1; j<nrooms(); j++) {
         auto m2 = schedule(sl,j);
         if(m2 >= nmini) continue;
         // If this item is supposed to be in room i, put it there
-        if(mini_[m2].room_id() == i) {
+        if(mini_.room_id(m2) == i) {
           if(verbose) {
             printf("assigning %i at position %i to room %i as requested\n", m2, j, i);
           }
@@ -92,9 +153,9 @@ void Scheduler::fix_order(View2D schedule, bool verbose) const {
           min_value = 0;
           break;
         }
-        if(mini_[m2].priority() < min_value) {
+        if(mini_.priority(m2) < min_value) {
           min_index = j;
-          min_value = mini_[m2].priority();
+          min_value = mini_.priority(m2);
         }
       }
       if(min_index != i) {
@@ -103,8 +164,8 @@ void Scheduler::fix_order(View2D schedule, bool verbose) const {
       if(verbose) {
         auto mid = schedule(sl,i);
         if(mid < nmini) {
-          unsigned priority = mini_[mid].priority();
-          unsigned rid = mini_[mid].room_id();
+          unsigned priority = mini_.priority(mid);
+          unsigned rid = mini_.room_id(mid);
 //          printf("schedule(%i,%i) = %i with priority %i and room id %i\n", sl, i, mid, priority, rid);
         }
         else {
@@ -114,60 +175,97 @@ void Scheduler::fix_order(View2D schedule, bool verbose) const {
     }
   }
 
-  // If we can gumband multi-part minisymposia together, do that
-  for(unsigned sl1=0; sl1<nslots(); sl1++) {
-    for(unsigned r1=0; r1<nrooms(); r1++) {
-      unsigned m1 = schedule(sl1,r1);
-      if(m1 >= nmini) continue;
-      if(!mini_[m1].is_multipart()) continue;
-      for(unsigned sl2=sl1+1; sl2<nslots(); sl2++) {
-        for(unsigned r2=0; r2<nrooms(); r2++) {
-          unsigned m2 = schedule(sl2,r2);
-          if(m2 >= nmini) continue;
-          // Ignore minisymposia that don't have multiple parts
-          // They can't have this problem
-          if(!mini_[m2].is_multipart()) continue;
-          
-          // If the slot after the first is not valid for the second minisymposium,
-          // don't even think about gumbanding it (and vice versa)
-          if(!mini_.is_valid_timeslot(m2, sl1+1)) continue;
-          unsigned ms1p1 = schedule(sl1+1, r1);
-          if(ms1p1 < nmini && !mini_.is_valid_timeslot(ms1p1, sl2)) continue;
-
-          if(mini_.breaks_ordering(m2, m1) || mini_.breaks_ordering(m1, m2)) {
-            // swap the second minisymposium with whatever comes after the first
-            genetic::swap(schedule(sl2, r2), schedule(sl1+1, r1));
-          }
-        }
-      }
+  // Gumband the parts of multipart minisymposia together and put them in order
+  mini_.repair_chains(schedule);
+}
+
+// Without feasible sampling, the genes are a uniform random permutation.
+// Otherwise the minisymposia with room requests are placed first, since they
+// have the fewest cells to choose from, and the empty cells fill the rest.
+template<class GenesType, class Generator>
+void DeviceScheduler::seed_member(const GenesType& genes, Generator& gen) const {
+  using genetic::swap;
+  unsigned ngenes = genes.size();
+  if(!feasible_sampling_) {
+    for(unsigned k=0; k<ngenes; k++) {
+      genes(k) = k;
+    }
+    for(unsigned k=ngenes; k>1; k--) {
+      swap(genes(k-1), genes(gen.rand(k)));
     }
+    return;
   }
 
-  // If we can put multi-part minisymposia in order, do that
-  for(unsigned sl1=0; sl1<nslots(); sl1++) {
-    for(unsigned r1=0; r1<nrooms(); r1++) {
-      if(schedule(sl1,r1) >= nmini) continue;
-      for(unsigned sl2=sl1+1; sl2<nslots(); sl2++) {
-        for(unsigned r2=0; r2<nrooms(); r2++) {
-          if(schedule(sl2,r2) >= nmini) continue;
-          if(mini_.breaks_ordering(schedule(sl1,r1), schedule(sl2,r2))) {
-            if(verbose) {
-              printf("swapping s(%i,%i)=%i and s(%i,%i)=%i as requested\n", 
-                     sl1, r1, schedule(sl1, r1), sl2, r2, schedule(sl2, r2));
-            }
-            // swap the values
-            genetic::swap(schedule(sl1, r1), schedule(sl2, r2));
-          }
+  unsigned nmini = mini_.size();
+  for(unsigned k=0; k<ngenes; k++) {
+    genes(k) = GenesType::unset;
+  }
+  // Start from a random minisymposium, so none of them always chooses first
+  unsigned first = gen.rand(nmini);
+  for(unsigned pass=0; pass<2; pass++) {
+    bool requested = pass == 0;
+    for(unsigned i=0; i<nmini; i++) {
+      unsigned mid = (first + i) % nmini;
+      if((mini_.room_id(mid) < nrooms()) != requested) continue;
+      genes(free_cell(genes, mid, gen)) = mid;
+    }
+  }
+  unsigned empty = nmini;
+  for(unsigned k=0; k<ngenes; k++) {
+    if(genes(k) == GenesType::unset) {
+      genes(k) = empty++;
+    }
+  }
+}
+
+// Returns a free cell in a valid timeslot for minisymposium mid, in its
+// requested room if it has one.  The timeslots and rooms are visited from a
+// random starting point, and any free cell will do if none of those is left.
+template<class GenesType, class Generator>
+unsigned DeviceScheduler::free_cell(const GenesType& genes, unsigned mid, Generator& gen) const {
+  // Genes are flattened column by column, so cell k is in timeslot k % nslots
+  unsigned room = mini_.room_id(mid);
+  unsigned first_slot = gen.rand(nslots());
+  for(unsigned pass=0; pass<2; pass++) {
+    bool feasible = pass == 0;
+    for(unsigned i=0; i<nslots(); i++) {
+      unsigned sl = (first_slot + i) % nslots();
+      if(feasible && !mini_.is_valid_timeslot(mid, sl)) continue;
+      if(feasible && room < nrooms()) {
+        if(genes(room*nslots() + sl) == GenesType::unset) {
+          return room*nslots() + sl;
+        }
+        continue;
+      }
+      unsigned first_room = gen.rand(nrooms());
+      for(unsigned j=0; j<nrooms(); j++) {
+        unsigned k = ((first_room + j) % nrooms())*nslots() + sl;
+        if(genes(k) == GenesType::unset) {
+          return k;
         }
       }
     }
   }
+  // There are at least as many cells as minisymposia, so this is unreachable
+  return 0;
 }
 
-template<class View2D>
-void Scheduler::record(const std::string& filename, View2D schedule) const {
+// With feasible sampling, a mutation must leave both minisymposia in valid timeslots
+template<class GenesType>
+bool DeviceScheduler::accepts_swap(const GenesType& genes, unsigned k1, unsigned k2) const {
+  if(!feasible_sampling_) return true;
   unsigned nmini = mini_.size();
-  auto class_codes = mini_.class_codes();
+  unsigned m1 = genes(k1), m2 = genes(k2);
+  unsigned sl1 = k1 % nslots(), sl2 = k2 % nslots();
+  return (m1 >= nmini || mini_.is_valid_timeslot(m1, sl2)) &&
+         (m2 >= nmini || mini_.is_valid_timeslot(m2, sl1));
+}
+
+template<class Gene>
+template<class View2D>
+void BasicScheduler<Gene>::record(const std::string& filename, View2D schedule) const {
+  unsigned nmini = host_mini_.size();
+  auto class_codes = host_mini_.class_codes();
 
   std::ofstream fout(filename);
   fout << "# Conference schedule\n\n";
@@ -177,9 +275,9 @@ void Scheduler::record(const std::string& filename, View2D schedule) const {
     for(unsigned room=0; room<nrooms(); room++) {
       unsigned mid = schedule(slot, room);
       if(mid < nmini) {
-        fout << "|" << mini_.get(mid).id() << " " << mini_.get(mid).full_title() << "|" << class_codes(mid,0) << " " 
-             << class_codes(mid, 1) << " " << class_codes(mid, 2) << "|" << mini_.get(mid).priority() 
-             << "|" << mini_.rooms().name(room) << "|\n";
+        fout << "|" << host_mini_.get(mid).id() << " " << host_mini_.get(mid).full_title() << "|" << class_codes(mid,0) << " " 
+             << class_codes(mid, 1) << " " << class_codes(mid, 2) << "|" << host_mini_.get(mid).priority() 
+             << "|" << host_mini_.rooms().name(room) << "|\n";
       }
     }
     fout << "\n";
@@ -187,7 +285,7 @@ void Scheduler::record(const std::string& filename, View2D schedule) const {
 
   fout << "\n|ID|Title|Priority (lower is better)|\n";
   for(unsigned i=0; i<nmini; i++) {
-    fout << "|" << mini_.get(i).id() << "|" << mini_.get(i).full_title() << "|" << mini_.get(i).priority() << "|\n";
+    fout << "|" << host_mini_.get(i).id() << "|" << host_mini_.get(i).full_title() << "|" << host_mini_.get(i).priority() << "|\n";
   }
 }
 
@@ -0,0 +1,157 @@
+#ifndef SELECTION_H
+#define SELECTION_H
+
+#include "Kokkos_Core.hpp"
+
+namespace genetic {
+
+// Selection policies for Genetic.  prepare is called on the host once per
+// generation, after the ratings are ranked, with the number of children that
+// will be bred and a uniform random offset in [0, 1).  select is called on
+// the device for one of those children and returns an index into the
+// ratings.  first is true when choosing the first parent, and false when
+// choosing (or retrying) the second.
+
+// Chooses each parent with probability proportional to how much its rating
+// exceeds the lowest rating, by binary searching the cumulative weights
+class RouletteSelection {
+public:
+  void prepare(Kokkos::View<double*> ratings, double min_rating, unsigned nchildren, double offset);
+
+  template<class Generator>
+  KOKKOS_INLINE_FUNCTION unsigned select(unsigned child, bool first, Generator& gen) const;
+private:
+  Kokkos::View<double*> cumulative_weights_;
+  double weight_sum_;
+};
+
+// Chooses the best of K uniformly drawn members.  It needs no weights, and
+// a larger K increases the selection pressure.
+template<unsigned K=2>
+class TournamentSelection {
+public:
+  void prepare(Kokkos::View<double*> ratings, double min_rating, unsigned nchildren, double offset);
+
+  template<class Generator>
+  KOKKOS_INLINE_FUNCTION unsigned select(unsigned child, bool first, Generator& gen) const;
+private:
+  Kokkos::View<double*> ratings_;
+};
+
+// Stochastic universal sampling: draws the first parent of every child in one
+// pass, with a single random offset and evenly spaced pointers into the
+// cumulative weights, so the number of times a member is chosen stays close
+// to its expected value.  The second parent is drawn uniformly from the same
+// mating pool.
+class StochasticUniversalSelection {
+public:
+  void prepare(Kokkos::View<double*> ratings, double min_rating, unsigned nchildren, double offset);
+
+  template<class Generator>
+  KOKKOS_INLINE_FUNCTION unsigned select(unsigned child, bool first, Generator& gen) const;
+private:
+  Kokkos::View<double*> cumulative_weights_;
+  Kokkos::View<unsigned*> mating_pool_;
+};
+
+// Returns the index of the first cumulative weight larger than r
+KOKKOS_INLINE_FUNCTION unsigned first_weight_above(Kokkos::View<double*> cumulative_weights, double r) {
+  unsigned lo = 0, hi = cumulative_weights.extent(0)-1;
+  while(lo < hi) {
+    unsigned mid = (lo + hi) / 2;
+    if(r < cumulative_weights(mid)) {
+      hi = mid;
+    }
+    else {
+      lo = mid+1;
+    }
+  }
+  return lo;
+}
+
+// Accumulates the amount each rating exceeds min_rating, returning the total.
+// The weights are summed in fixed point, since integer addition gives the
+// same total however the scan is partitioned across threads.
+inline double cumulative_weights(Kokkos::View<double*> ratings, double min_rating, Kokkos::View<double*>& weights) {
+  unsigned popSize = ratings.extent(0);
+  if(weights.extent(0) != popSize) {
+    weights = Kokkos::View<double*>("cumulative weights", popSize);
+  }
+  auto lweights = weights;
+  const double scale = 4294967296.0;
+  uint64_t weight_sum;
+  Kokkos::parallel_scan("Cumulative weights", popSize, KOKKOS_LAMBDA (unsigned i, uint64_t& partial_sum, const bool is_final) {
+    partial_sum += uint64_t((ratings(i) - min_rating) * scale);
+    if(is_final) {
+      lweights(i) = partial_sum / scale;
+    }
+  }, weight_sum);
+  return weight_sum / scale;
+}
+
+inline void RouletteSelection::prepare(Kokkos::View<double*> ratings, double min_rating, unsigned nchildren, double offset) {
+  weight_sum_ = cumulative_weights(ratings, min_rating, cumulative_weights_);
+}
+
+template<class Generator>
+unsigned RouletteSelection::select(unsigned child, bool first, Generator& gen) const {
+  unsigned popSize = cumulative_weights_.extent(0);
+
+  // If every member has the same rating, they are all equally likely
+  if(weight_sum_ <= 0.0) {
+    return gen.rand(popSize);
+  }
+
+  // Determine which population member has been randomly chosen by finding
+  // the first cumulative weight larger than r
+  return first_weight_above(cumulative_weights_, gen.drand() * weight_sum_);
+}
+
+template<unsigned K>
+void TournamentSelection<K>::prepare(Kokkos::View<double*> ratings, double min_rating, unsigned nchildren, double offset) {
+  ratings_ = ratings;
+}
+
+template<unsigned K>
+template<class Generator>
+unsigned TournamentSelection<K>::select(unsigned child, bool first, Generator& gen) const {
+  unsigned popSize = ratings_.extent(0);
+  unsigned best = gen.rand(popSize);
+  for(unsigned k=1; k<K; k++) {
+    unsigned contender = gen.rand(popSize);
+    if(ratings_(contender) > ratings_(best)) {
+      best = contender;
+    }
+  }
+  return best;
+}
+
+inline void StochasticUniversalSelection::prepare(Kokkos::View<double*> ratings, double min_rating, unsigned nchildren, double offset) {
+  double weight_sum = cumulative_weights(ratings, min_rating, cumulative_weights_);
+  unsigned popSize = ratings.extent(0);
+  if(mating_pool_.extent(0) != nchildren) {
+    mating_pool_ = Kokkos::View<unsigned*>("mating pool", nchildren);
+  }
+
+  auto weights = cumulative_weights_;
+  auto mating_pool = mating_pool_;
+  double spacing = weight_sum / nchildren;
+  Kokkos::parallel_for("SUS pointers", nchildren, KOKKOS_LAMBDA (unsigned i) {
+    // If every member has the same rating, they are all equally likely
+    if(weight_sum <= 0.0) {
+      mating_pool(i) = i % popSize;
+    }
+    else {
+      mating_pool(i) = first_weight_above(weights, (i + offset) * spacing);
+    }
+  });
+}
+
+template<class Generator>
+unsigned StochasticUniversalSelection::select(unsigned child, bool first, Generator& gen) const {
+  return first ? mating_pool_(child) : mating_pool_(gen.rand(mating_pool_.extent(0)));
+}
+
+} // namespace genetic
+
+#endif /* SELECTION_H */
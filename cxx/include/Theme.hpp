@@ -19,6 +19,7 @@ public:
 
   const std::string& name() const;
 
+  unsigned id() const;
   unsigned stem() const;
 
   Similarity compare(const Theme& theme) const;
@@ -2,6 +2,8 @@
 #define UTILITY_H
 
 #include "Kokkos_Core.hpp"
+#include <cstdint>
+#include <limits>
 
 namespace genetic {
 
@@ -45,6 +47,25 @@ bool find(ViewType view, ValType val, unsigned& index) {
   return false;
 }
 
+// Determines whether val is in the sorted entries view(begin), ..., view(end-1)
+template<class ViewType, class ValType>
+KOKKOS_FUNCTION
+bool sorted_contains(ViewType view, unsigned begin, unsigned end, ValType val) {
+  while(begin < end) {
+    unsigned mid = (begin + end) / 2;
+    if(view(mid) == val) {
+      return true;
+    }
+    if(view(mid) < val) {
+      begin = mid+1;
+    }
+    else {
+      end = mid;
+    }
+  }
+  return false;
+}
+
 template<class Scalar>
 KOKKOS_FUNCTION
 void swap(Scalar& s1, Scalar& s2) {
@@ -53,6 +74,25 @@ void swap(Scalar& s1, Scalar& s2) {
   s2 = temp;
 }
 
+// Determines whether Gene can hold ngenes distinct values, keeping its
+// largest value free to mark the genes a crossover has not filled yet
+template<class Gene>
+bool fits_gene_type(size_t ngenes) {
+  return ngenes < size_t(std::numeric_limits<Gene>::max());
+}
+
+// Calls functor with a value of the narrowest gene type that fits, so the
+// caller can pick the runner, e.g. BasicScheduler<decltype(gene)>
+template<class Functor>
+void with_gene_type(size_t ngenes, Functor functor) {
+  if(fits_gene_type<uint16_t>(ngenes)) {
+    functor(uint16_t());
+  }
+  else {
+    functor(unsigned());
+  }
+}
+
 } // namespace genetic
 
 #endif /* UTILITY_H */
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "BlockScheduler.hpp"
+#include <algorithm>
+#include <vector>
+
+DeviceBlockScheduler::DeviceBlockScheduler(const Minisymposia& mini) :
+  mini_(mini.device_handle()),
+  schedule_token_(Kokkos::DefaultExecutionSpace().concurrency())
+{
+  unsigned nmini = mini.size();
+  unsigned ncells = mini.nslots()*mini.nrooms();
+
+  // The items are the chains, then the minisymposia with one part, then the empty cells
+  std::vector<std::vector<unsigned>> items = mini.chains();
+  std::vector<bool> chained(nmini, false);
+  for(const auto& parts : items) {
+    for(unsigned m : parts) {
+      chained[m] = true;
+    }
+  }
+  for(unsigned m=0; m<nmini; m++) {
+    if(!chained[m]) {
+      items.push_back({m});
+    }
+  }
+  nfilled_items_ = items.size();
+  for(unsigned m=nmini; m<ncells; m++) {
+    items.push_back({m});
+  }
+
+  unsigned nitems = items.size();
+  item_offsets_ = Kokkos::View<unsigned*>("item offsets", nitems+1);
+  auto h_item_offsets = Kokkos::create_mirror_view(item_offsets_);
+  h_item_offsets(0) = 0;
+  for(unsigned i=0; i<nitems; i++) {
+    h_item_offsets(i+1) = h_item_offsets(i) + items[i].size();
+  }
+
+  item_cells_ = Kokkos::View<unsigned*>("item cells", h_item_offsets(nitems));
+  auto h_item_cells = Kokkos::create_mirror_view(item_cells_);
+  for(unsigned i=0; i<nitems; i++) {
+    std::copy(items[i].begin(), items[i].end(), h_item_cells.data() + h_item_offsets(i));
+  }
+
+  Kokkos::deep_copy(item_offsets_, h_item_offsets);
+  Kokkos::deep_copy(item_cells_, h_item_cells);
+
+  schedules_ = Kokkos::View<unsigned***>("decoded schedules", schedule_token_.size(), mini.nslots(), mini.nrooms());
+}
+
+size_t DeviceBlockScheduler::team_scratch_size() const {
+  return 0;
+}
+
+// Swap only the items that hold minisymposia
+bool DeviceBlockScheduler::out_of_bounds(unsigned i) const {
+  return i >= nfilled_items_;
+}
+
+KOKKOS_FUNCTION
+unsigned DeviceBlockScheduler::nslots() const {
+  return mini_.nslots();
+}
+
+KOKKOS_FUNCTION
+unsigned DeviceBlockScheduler::nrooms() const {
+  return mini_.nrooms();
+}
+
+template<class Gene>
+BasicBlockScheduler<Gene>::BasicBlockScheduler(const Minisymposia& mini) :
+  DeviceBlockScheduler(mini),
+  h_item_offsets_(Kokkos::create_mirror_view_and_copy(Kokkos::HostSpace(), item_offsets_)),
+  h_item_cells_(Kokkos::create_mirror_view_and_copy(Kokkos::HostSpace(), item_cells_)),
+  scheduler_(mini)
+{
+
+}
+
+template<class Gene>
+typename BasicBlockScheduler<Gene>::ViewType BasicBlockScheduler<Gene>::make_initial_population(unsigned nschedules) const {
+  return ViewType("block schedules", nschedules, nitems());
+}
+
+template<class Gene>
+unsigned BasicBlockScheduler<Gene>::nitems() const {
+  return item_offsets_.extent(0)-1;
+}
+
+template<class Gene>
+const typename BasicBlockScheduler<Gene>::DeviceHandle& BasicBlockScheduler<Gene>::device_handle() const {
+  return *this;
+}
+
+template class BasicBlockScheduler<uint16_t>;
+template class BasicBlockScheduler<unsigned>;
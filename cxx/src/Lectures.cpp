@@ -29,13 +29,18 @@ Lectures::Lectures(const std::string& filename) {
 
   // Copy the data to device
   Kokkos::deep_copy(class_codes_, h_codes);
+  h_class_codes_ = h_codes;
 }
 
-unsigned Lectures::size() const {
+const DeviceLectures& Lectures::device_handle() const {
+  return *this;
+}
+
+unsigned DeviceLectures::size() const {
   return class_codes_.extent(0);
 }
 
-unsigned Lectures::topic_cohesion_score(unsigned first, unsigned second) const {
+unsigned DeviceLectures::topic_cohesion_score(unsigned first, unsigned second) const {
   unsigned score = 0;
 
   for(unsigned i=0; i<3; i++) {
@@ -49,7 +54,7 @@ unsigned Lectures::topic_cohesion_score(unsigned first, unsigned second) const {
   return pow(score,2);
 }
 
-KOKKOS_FUNCTION unsigned Lectures::topic_cohesion_score(const Minisymposia& mini, unsigned mid, unsigned lid) const {
+KOKKOS_FUNCTION unsigned DeviceLectures::topic_cohesion_score(const DeviceMinisymposia& mini, unsigned mid, unsigned lid) const {
   unsigned score = 0;
 
   for(unsigned i=0; i<3; i++) {
@@ -72,7 +77,5 @@ unsigned Lectures::id(unsigned index) const {
 }
 
 Kokkos::View<Theme*[3]>::HostMirror Lectures::class_codes() const {
-  auto h_codes = Kokkos::create_mirror_view(class_codes_);
-  Kokkos::deep_copy(h_codes, class_codes_);
-  return h_codes;
+  return h_class_codes_;
 }
\ No newline at end of file
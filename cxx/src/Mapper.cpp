@@ -1,24 +1,39 @@
 #include "Mapper.hpp"
 #include "Utility.hpp"
 
-Mapper::Mapper(const Lectures& lectures, const Minisymposia& minisymposia, unsigned nExtraMini) :
-  lectures_(lectures), minisymposia_(minisymposia), nExtraMini_(nExtraMini) { }
+DeviceMapper::DeviceMapper(const DeviceLectures& lectures, const DeviceMinisymposia& minisymposia) :
+  lectures_(lectures), minisymposia_(minisymposia) { }
 
-Mapper::ViewType Mapper::make_initial_population(unsigned popSize) {
+template<class Gene>
+BasicMapper<Gene>::BasicMapper(const Lectures& lectures, const Minisymposia& minisymposia, unsigned nExtraMini) :
+  DeviceMapper(lectures.device_handle(), minisymposia.device_handle()),
+  host_lectures_(lectures), host_minisymposia_(minisymposia), nExtraMini_(nExtraMini) { }
+
+template<class Gene>
+const typename BasicMapper<Gene>::DeviceHandle& BasicMapper<Gene>::device_handle() const {
+  return *this;
+}
+
+template<class Gene>
+typename BasicMapper<Gene>::ViewType BasicMapper<Gene>::make_initial_population(unsigned popSize) {
+  return ViewType("mappings", popSize, ngenes());
+}
+
+// The number of open lecture positions, which each hold one gene
+template<class Gene>
+unsigned BasicMapper<Gene>::ngenes() const {
   // Count the number of lectures in each minisymposium
-  unsigned nmini = minisymposia_.size();
+  unsigned nmini = host_minisymposia_.size();
   unsigned nextra_lect_in_mini = 0;
   for(unsigned i=0; i<nmini; i++) {
-    unsigned nlect_in_mini = minisymposia_.get(i).size();
+    unsigned nlect_in_mini = host_minisymposia_.get(i).size();
     nextra_lect_in_mini += nlect_per_mini_ - nlect_in_mini;
   }
-
-  unsigned nlectures = lectures_.size();
-  unsigned ngenes = nextra_lect_in_mini + nlect_per_mini_*nExtraMini_;
-  return Kokkos::View<unsigned**>("mappings", popSize, ngenes);
+  return nextra_lect_in_mini + nlect_per_mini_*nExtraMini_;
 }
 
-void Mapper::smush() {
+template<class Gene>
+void BasicMapper<Gene>::smush() {
 /*
   unsigned nmappings = current_mappings_.extent(0);
   unsigned nlectures = lectures_.size();
@@ -56,6 +71,13 @@ void Mapper::smush() {
 */
 }
 
-bool Mapper::out_of_bounds(unsigned i) const {
+bool DeviceMapper::out_of_bounds(unsigned i) const {
   return i >= lectures_.size();
-}
\ No newline at end of file
+}
+
+size_t DeviceMapper::team_scratch_size() const {
+  return 0;
+}
+
+template class BasicMapper<uint16_t>;
+template class BasicMapper<unsigned>;
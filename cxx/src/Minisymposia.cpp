@@ -1,5 +1,7 @@
 #include "yaml-cpp/yaml.h"
 #include "Minisymposia.hpp"
+#include <algorithm>
+#include <map>
 
 Minisymposia::Minisymposia(const std::string& filename) {
   // Read the minisymposia from yaml on the host
@@ -8,8 +10,7 @@ Minisymposia::Minisymposia(const std::string& filename) {
   unsigned n = nodes.size();
   class_codes_ = Kokkos::View<Theme*[3]>("classification codes", n);
   auto h_codes = Kokkos::create_mirror_view(class_codes_);
-  d_data_ = Kokkos::View<Minisymposium*>("minisymposia", n);
-  h_data_ = Kokkos::create_mirror_view(d_data_);
+  data_.resize(n);
 
   unsigned i=0;
   for(auto node : nodes) {
@@ -46,13 +47,14 @@ Minisymposia::Minisymposia(const std::string& filename) {
       speakers[j] = Speaker(speaker_names[j]);
     }
 
-    h_data_[i] = Minisymposium(id, title, talks, organizers, speakers, room, valid_timeslots);
+    data_[i] = Minisymposium(id, title, talks, organizers, speakers, room, valid_timeslots);
     i++;
   }
 
   // Copy the data to device
-  Kokkos::deep_copy(d_data_, h_data_);
+  compile();
   Kokkos::deep_copy(class_codes_, h_codes);
+  h_class_codes_ = h_codes;
 }
 
 Minisymposia::Minisymposia(const std::string& filename, const Rooms& rooms, const Timeslots& slots) :
@@ -63,6 +65,8 @@ Minisymposia::Minisymposia(const std::string& filename, const Rooms& rooms, cons
 
   unsigned nrooms = rooms.size();
   unsigned nslots = slots.size();
+  nrooms_ = nrooms;
+  nslots_ = nslots;
 
   set_room_penalties(rooms);
   set_overlapping_participants();
@@ -73,47 +77,121 @@ Minisymposia::Minisymposia(const std::string& filename, const Rooms& rooms, cons
   set_priority_penalty_bounds(nslots);
 }
 
-KOKKOS_FUNCTION unsigned Minisymposia::size() const {
-  return d_data_.extent(0);
+// Lowers the fields of each minisymposium used by the kernels into 
+// device arrays, leaving the strings on the host
+void Minisymposia::compile() {
+  unsigned n = data_.size();
+  ids_ = Kokkos::View<unsigned*>("minisymposium ids", n);
+  room_ids_ = Kokkos::View<unsigned*>("minisymposium room ids", n);
+  priorities_ = Kokkos::View<unsigned*>("minisymposium priorities", n);
+  nlectures_ = Kokkos::View<unsigned*>("minisymposium lecture counts", n);
+  is_multipart_ = Kokkos::View<bool*>("minisymposium is multipart", n);
+  auto h_ids = Kokkos::create_mirror_view(ids_);
+  auto h_room_ids = Kokkos::create_mirror_view(room_ids_);
+  auto h_priorities = Kokkos::create_mirror_view(priorities_);
+  auto h_nlectures = Kokkos::create_mirror_view(nlectures_);
+  auto h_is_multipart = Kokkos::create_mirror_view(is_multipart_);
+  for(unsigned i=0; i<n; i++) {
+    h_ids(i) = data_[i].id();
+    h_room_ids(i) = data_[i].room_id();
+    h_priorities(i) = data_[i].priority();
+    h_nlectures(i) = data_[i].size();
+    h_is_multipart(i) = data_[i].is_multipart();
+  }
+  Kokkos::deep_copy(ids_, h_ids);
+  Kokkos::deep_copy(room_ids_, h_room_ids);
+  Kokkos::deep_copy(priorities_, h_priorities);
+  Kokkos::deep_copy(nlectures_, h_nlectures);
+  Kokkos::deep_copy(is_multipart_, h_is_multipart);
 }
 
-KOKKOS_FUNCTION
-const Minisymposium& Minisymposia::operator[](unsigned i) const {
-  assert(i < size());
-  return d_data_[i];
+KOKKOS_FUNCTION unsigned DeviceMinisymposia::size() const {
+  return ids_.extent(0);
 }
 
 const Minisymposium& Minisymposia::get(unsigned i) const {
   assert(i < size());
-  return h_data_[i];
+  return data_[i];
+}
+
+const DeviceMinisymposia& Minisymposia::device_handle() const {
+  return *this;
+}
+
+KOKKOS_FUNCTION unsigned DeviceMinisymposia::id(unsigned mid) const {
+  return ids_(mid);
+}
+
+KOKKOS_FUNCTION unsigned DeviceMinisymposia::room_id(unsigned mid) const {
+  return room_ids_(mid);
+}
+
+KOKKOS_FUNCTION unsigned DeviceMinisymposia::priority(unsigned mid) const {
+  return priorities_(mid);
+}
+
+KOKKOS_FUNCTION unsigned DeviceMinisymposia::nlectures(unsigned mid) const {
+  return nlectures_(mid);
+}
+
+KOKKOS_FUNCTION bool DeviceMinisymposia::is_multipart(unsigned mid) const {
+  return is_multipart_(mid);
+}
+
+KOKKOS_FUNCTION
+bool DeviceMinisymposia::overlaps_participants(unsigned m1, unsigned m2) const {
+  return genetic::sorted_contains(participant_neighbors_, participant_offsets_(m1), 
+                                  participant_offsets_(m1+1), m2);
 }
 
 KOKKOS_FUNCTION
-bool Minisymposia::overlaps_participants(unsigned m1, unsigned m2) const {
-  return same_participants_(m1, m2);
+bool DeviceMinisymposia::breaks_ordering(unsigned m1, unsigned m2) const {
+  return is_prereq(m2, m1);
 }
 
 KOKKOS_FUNCTION
-bool Minisymposia::breaks_ordering(unsigned m1, unsigned m2) const {
-  return is_prereq_(m2, m1);
+bool DeviceMinisymposia::is_prereq(unsigned m1, unsigned m2) const {
+  return genetic::sorted_contains(successors_, successor_offsets_(m1), successor_offsets_(m1+1), m2);
 }
 
-unsigned Minisymposia::get_max_penalty() const {
+// Stores the sorted rows of a sparse boolean matrix in compressed sparse row format
+static void compress_rows(const std::vector<std::vector<unsigned>>& rows, const std::string& label,
+                          Kokkos::View<unsigned*>& offsets, Kokkos::View<unsigned*>& columns) 
+{
+  unsigned nrows = rows.size();
+  offsets = Kokkos::View<unsigned*>(label + " offsets", nrows+1);
+  auto h_offsets = Kokkos::create_mirror_view(offsets);
+  h_offsets(0) = 0;
+  for(unsigned i=0; i<nrows; i++) {
+    h_offsets(i+1) = h_offsets(i) + rows[i].size();
+  }
+
+  columns = Kokkos::View<unsigned*>(label, h_offsets(nrows));
+  auto h_columns = Kokkos::create_mirror_view(columns);
+  for(unsigned i=0; i<nrows; i++) {
+    std::copy(rows[i].begin(), rows[i].end(), h_columns.data() + h_offsets(i));
+  }
+
+  Kokkos::deep_copy(offsets, h_offsets);
+  Kokkos::deep_copy(columns, h_columns);
+}
+
+unsigned DeviceMinisymposia::get_max_penalty() const {
   return max_penalty_;
 }
 
 void Minisymposia::set_room_penalties(const Rooms& rooms) {
   unsigned nrooms = rooms.size();
-  for(unsigned i=0; i<h_data_.extent(0); i++) {
-    unsigned id = rooms.get_id(h_data_(i).room());
-    h_data_(i).set_room_id(id);
+  for(unsigned i=0; i<data_.size(); i++) {
+    unsigned id = rooms.get_id(data_[i].room());
+    data_[i].set_room_id(id);
     if(id != nrooms) {
       max_penalty_++;
     }
   }
 
   // Copy the data to device
-  Kokkos::deep_copy(d_data_, h_data_);
+  compile();
 
   printf("set_room_penalties max_penalty: %i\n", max_penalty_);
 }
@@ -124,21 +202,20 @@ void Minisymposia::set_overlapping_participants() {
   using Kokkos::RangePolicy;
 
   size_t nmini = size();
-  same_participants_ = Kokkos::View<bool**>("overlapping participants", nmini, nmini);
-  auto h_same_participants = Kokkos::create_mirror_view(same_participants_);
+  std::vector<std::vector<unsigned>> same_participants(nmini);
 
   unsigned overlap_penalty = 0;
   RangePolicy<DefaultHostExecutionSpace> rp(DefaultHostExecutionSpace(), 0, nmini);
-  parallel_reduce("set overlapping participants", rp, [=] (unsigned i, unsigned& lpenalty ) {
+  parallel_reduce("set overlapping participants", rp, [&] (unsigned i, unsigned& lpenalty ) {
     for(int j=0; j<nmini; j++) {
       if(i == j) continue;
-      if(h_data_[i].shares_participant(h_data_[j])) {
-        h_same_participants(i,j) = true;
+      if(data_[i].shares_participant(data_[j])) {
+        same_participants[i].push_back(j);
         lpenalty++;
       }
     }
   }, overlap_penalty);
-  Kokkos::deep_copy(same_participants_, h_same_participants);
+  compress_rows(same_participants, "overlapping participants", participant_offsets_, participant_neighbors_);
   max_penalty_ += overlap_penalty/2;
   printf("set_overlapping_participants max_penalty: %i\n", max_penalty_);
 }
@@ -149,21 +226,79 @@ void Minisymposia::set_prerequisites() {
   using Kokkos::RangePolicy;
 
   size_t nmini = size();
-  is_prereq_ = Kokkos::View<bool**>("prerequisites", nmini, nmini);
-  auto h_is_prereq = Kokkos::create_mirror_view(is_prereq_);
+  std::vector<std::vector<unsigned>> successors(nmini);
 
   nprereqs_ = 0;
   RangePolicy<DefaultHostExecutionSpace> rp(DefaultHostExecutionSpace(), 0, nmini);
-  parallel_reduce("set prerequisites", rp, [=] (unsigned i, unsigned& lpenalty ) {
+  parallel_reduce("set prerequisites", rp, [&] (unsigned i, unsigned& lpenalty ) {
     for(int j=0; j<nmini; j++) {
       if(i == j) continue;
-      if(h_data_[i].comes_before(h_data_[j])) {
-        h_is_prereq(i,j) = true;
+      if(data_[i].comes_before(data_[j])) {
+        successors[i].push_back(j);
         lpenalty++;
       }
     }
   }, nprereqs_);
-  Kokkos::deep_copy(is_prereq_, h_is_prereq);
+  compress_rows(successors, "successors", successor_offsets_, successors_);
+
+  // Every part but the last of each chain has one adjacent successor; the
+  // pairs of parts further apart keep their gumband time penalty
+  chained_gumband_time_ = nprereqs_;
+  for(unsigned i=0; i<nmini; i++) {
+    if(!successors[i].empty()) {
+      chained_gumband_time_--;
+    }
+  }
+
+  // List the other parts of each minisymposium so a single minisymposium
+  // can be rated without looking at the whole schedule
+  std::vector<std::vector<unsigned>> partners(nmini);
+  for(unsigned i=0; i<nmini; i++) {
+    for(unsigned j : successors[i]) {
+      partners[i].push_back(j);
+      partners[j].push_back(i);
+    }
+  }
+  for(auto& row : partners) {
+    std::sort(row.begin(), row.end());
+  }
+  compress_rows(partners, "prerequisite partners", prereq_offsets_, prereq_partners_);
+
+  // List the prerequisite pairs so rate_schedule can skip the minisymposia 
+  // with only one part
+  prereq_pairs_ = Kokkos::View<unsigned*[2]>("prerequisite pairs", nprereqs_);
+  auto h_prereq_pairs = Kokkos::create_mirror_view(prereq_pairs_);
+  unsigned npairs = 0;
+  for(unsigned i=0; i<nmini; i++) {
+    for(unsigned j : successors[i]) {
+      h_prereq_pairs(npairs,0) = i;
+      h_prereq_pairs(npairs,1) = j;
+      npairs++;
+    }
+  }
+  Kokkos::deep_copy(prereq_pairs_, h_prereq_pairs);
+
+  // Chain the parts of each multipart minisymposium in order, so fix_order
+  // can repair them without scanning the whole schedule
+  std::map<std::string, std::vector<unsigned>> chains_by_title;
+  for(unsigned i=0; i<nmini; i++) {
+    if(data_[i].is_multipart()) {
+      chains_by_title[data_[i].short_title()].push_back(i);
+    }
+  }
+  std::vector<std::vector<unsigned>> chains;
+  for(auto& [title, parts] : chains_by_title) {
+    std::sort(parts.begin(), parts.end(), [&](unsigned a, unsigned b) {
+      return data_[a].comes_before(data_[b]);
+    });
+    chains.push_back(parts);
+  }
+  compress_rows(chains, "multipart chains", chain_offsets_, chain_parts_);
+  chains_ = chains;
+
+  // Each thread gets its own scratch space for the positions of the minisymposia
+  positions_ = Kokkos::View<unsigned**>("minisymposium positions", position_token_.size(), nmini);
+
   max_penalty_ += nprereqs_; 
   printf("set_prerequisites max_penalty: %i\n", max_penalty_);
 }
@@ -171,13 +306,17 @@ void Minisymposia::set_prerequisites() {
 void Minisymposia::set_valid_timeslots(const Timeslots& slots) {
   size_t nmini = size();
   size_t nslots = slots.size();
-  valid_timeslots_ = Kokkos::View<bool**>("valid timeslots", nmini, nslots);
+  // Each minisymposium stores one bit per timeslot
+  valid_timeslots_ = Kokkos::View<uint32_t**>("valid timeslots", nmini, (nslots+31)/32);
   auto h_valid_timeslots_ = Kokkos::create_mirror_view(valid_timeslots_);
+  Kokkos::deep_copy(h_valid_timeslots_, 0);
   for(unsigned i=0; i<nmini; i++) {
     bool increase_penalty = false;
     for(unsigned j=0; j<nslots; j++) {
-      h_valid_timeslots_(i,j) = h_data_(i).is_valid_timeslot(j) && h_data_(i).size() <= slots.nlectures(j);
-      if(!h_valid_timeslots_(i,j)) {
+      if(data_[i].is_valid_timeslot(j) && data_[i].size() <= slots.nlectures(j)) {
+        h_valid_timeslots_(i,j/32) |= uint32_t(1) << (j%32);
+      }
+      else {
         increase_penalty = true;
       }
     }
@@ -190,51 +329,81 @@ void Minisymposia::set_valid_timeslots(const Timeslots& slots) {
 }
 
 KOKKOS_FUNCTION
-double Minisymposia::map_priority_penalty(unsigned nproblems) const {
+double DeviceMinisymposia::map_priority_penalty(unsigned nproblems) const {
   return (nproblems - min_priority_penalty_) / double(max_priority_penalty_ - min_priority_penalty_);
 }
 
 void Minisymposia::set_overlapping_themes(unsigned nrooms, unsigned nslots) {
-  using Kokkos::parallel_for;
-  using Kokkos::parallel_reduce;
-  using Kokkos::DefaultHostExecutionSpace;
-  using Kokkos::RangePolicy;
-
   size_t nmini = size();
-  theme_penalties_ = Kokkos::View<double**>("theme penalties", nmini, nmini);
-  auto h_theme_penalties = Kokkos::create_mirror_view(theme_penalties_);
   auto h_class_codes = Kokkos::create_mirror_view(class_codes_);
   Kokkos::deep_copy(h_class_codes, class_codes_);
 
-  double total = 0;
+  // Number the themes and stems that occur, keeping the two apart
+  std::map<std::pair<bool, unsigned>, uint16_t> bins;
+  theme_bins_ = Kokkos::View<uint16_t*[6]>("theme bins", nmini);
+  theme_self_pairs_ = Kokkos::View<uint8_t*>("theme self pairs", nmini);
+  auto h_theme_bins = Kokkos::create_mirror_view(theme_bins_);
+  auto h_theme_self_pairs = Kokkos::create_mirror_view(theme_self_pairs_);
   for(unsigned i=0; i<nmini; i++) {
-    for(unsigned j=0; j<nmini; j++) {
-      if(i == j) continue;
-      h_theme_penalties(i,j) = compute_topic_score(i, j, h_class_codes);
-      total += 2*h_theme_penalties(i,j);
+    for(unsigned c=0; c<3; c++) {
+      std::pair<bool, unsigned> theme(false, h_class_codes(i,c).id());
+      std::pair<bool, unsigned> stem(true, h_class_codes(i,c).stem());
+      h_theme_bins(i,c) = bins.emplace(theme, bins.size()).first->second;
+      h_theme_bins(i,c+3) = bins.emplace(stem, bins.size()).first->second;
+    }
+    h_theme_self_pairs(i) = 0;
+    for(unsigned a=0; a<6; a++) {
+      for(unsigned b=a+1; b<6; b++) {
+        h_theme_self_pairs(i) += h_theme_bins(i,a) == h_theme_bins(i,b);
+      }
     }
   }
 
-  // Scale the penalties so the theme penalty will always be in the range [0,0.5]
+  // The pairs of all minisymposia, found the same way as slot_theme_score
+  std::vector<unsigned> counts(bins.size(), 0);
+  double pairs = 0;
   for(unsigned i=0; i<nmini; i++) {
-    for(unsigned j=0; j<nmini; j++) {
-      if(i == j) continue;
-      h_theme_penalties(i,j) /= total;
+    for(unsigned b=0; b<6; b++) {
+      pairs += counts[h_theme_bins(i,b)]++;
     }
+    pairs -= h_theme_self_pairs(i);
   }
 
-  Kokkos::deep_copy(theme_penalties_, h_theme_penalties);
+  // Scale the penalties so the theme penalty will always be in the range [0,0.5]
+  theme_total_ = 4*pairs;
+
+  Kokkos::deep_copy(theme_bins_, h_theme_bins);
+  Kokkos::deep_copy(theme_self_pairs_, h_theme_self_pairs);
+  theme_counts_ = Kokkos::View<uint16_t**>("theme counts", position_token_.size(), bins.size());
+}
+
+size_t DeviceMinisymposia::team_scratch_size() const {
+  using ScratchView = Kokkos::View<unsigned*, Kokkos::DefaultExecutionSpace::scratch_memory_space, Kokkos::MemoryUnmanaged>;
+  return ScratchView::shmem_size(size());
+}
+
+KOKKOS_FUNCTION
+double DeviceMinisymposia::score(const SchedulePenalties& penalties) const {
+  double penalty = penalties.order + penalties.oversubscribed + penalties.room + penalties.timeslot;
+  penalty += penalties.theme + (penalties.gumband_time + penalties.gumband_room)/(double)nprereqs_ 
+           + map_priority_penalty(penalties.priority);
+  return 1 - penalty / max_penalty_;
+}
+
+double DeviceMinisymposia::max_rating() const {
+  SchedulePenalties penalties{0, chained_gumband_time_, 0, 0, 0.0, 0, 0, min_priority_penalty_};
+  return score(penalties);
 }
 
 void Minisymposia::set_priorities(unsigned nslots) {
   // Get the citations
   std::vector<std::pair<unsigned,unsigned>> citation_list(size());
   for(unsigned i=0; i<size(); i++) {
-    std::string title = h_data_[i].short_title();
+    std::string title = data_[i].short_title();
     unsigned citations = 0;
     for(unsigned j=0; j<size(); j++) {
-      if(h_data_[j].short_title() == title) {
-        citations += h_data_[j].max_citation_count();
+      if(data_[j].short_title() == title) {
+        citations += data_[j].max_citation_count();
       }
     }
     citation_list[i] = std::make_pair(citations,i);
@@ -249,17 +418,17 @@ void Minisymposia::set_priorities(unsigned nslots) {
   for(unsigned i=0; i<size(); i++) {
     for(unsigned j=0; j<nslots && i*nslots+j<size(); j++) {
       unsigned index = citation_list[i*nslots+j].second;
-      h_data_[index].set_priority(i);
+      data_[index].set_priority(i);
     }
   }
-  Kokkos::deep_copy(d_data_, h_data_);
+  compile();
 }
 
 void Minisymposia::set_priority_penalty_bounds(unsigned nslots) {
   // Get the priorities
   std::vector<unsigned> priority_list(size());
   for(unsigned i=0; i<size(); i++) {
-    priority_list[i] = h_data_[i].priority();
+    priority_list[i] = data_[i].priority();
   }
 
   // Sort the priorities
@@ -296,18 +465,16 @@ void Minisymposia::set_priority_penalty_bounds(unsigned nslots) {
   printf("Priority penalty bounds: %i %i\n", min_priority_penalty_, max_priority_penalty_);
 }
 
-const Theme& Minisymposia::class_codes(unsigned mid, unsigned cid) const {
+const Theme& DeviceMinisymposia::class_codes(unsigned mid, unsigned cid) const {
   return class_codes_(mid, cid);
 }
 
 Kokkos::View<Theme*[3]>::HostMirror Minisymposia::class_codes() const {
-  auto h_class_codes = Kokkos::create_mirror_view(class_codes_);
-  Kokkos::deep_copy(h_class_codes, class_codes_);
-  return h_class_codes;
+  return h_class_codes_;
 }
 
-KOKKOS_FUNCTION bool Minisymposia::is_valid_timeslot(unsigned mid, unsigned sid) const {
-  return valid_timeslots_(mid, sid);
+KOKKOS_FUNCTION bool DeviceMinisymposia::is_valid_timeslot(unsigned mid, unsigned sid) const {
+  return (valid_timeslots_(mid, sid/32) >> (sid%32)) & 1;
 }
 
 const Timeslots& Minisymposia::timeslots() const {
@@ -318,9 +485,21 @@ const Rooms& Minisymposia::rooms() const {
   return rooms_;
 }
 
+const std::vector<std::vector<unsigned>>& Minisymposia::chains() const {
+  return chains_;
+}
+
+KOKKOS_FUNCTION unsigned DeviceMinisymposia::nslots() const {
+  return nslots_;
+}
+
+KOKKOS_FUNCTION unsigned DeviceMinisymposia::nrooms() const {
+  return nrooms_;
+}
+
 unsigned Minisymposia::find(unsigned mid) const {
   for(unsigned i=0; i<size(); i++) {
-    if(h_data_(i).id() == mid) return i;
+    if(data_[i].id() == mid) return i;
   }
   return size();
 }
\ No newline at end of file
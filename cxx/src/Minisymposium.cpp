@@ -90,7 +90,6 @@ bool Minisymposium::comes_before(const Minisymposium& m) const {
   return title_without_part_ == m.title_without_part_ && part_ < m.part_;
 }
 
-KOKKOS_FUNCTION
 unsigned Minisymposium::priority() const {
   return room_priority_;
 }
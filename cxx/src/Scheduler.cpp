@@ -3,26 +3,67 @@
 #include "Kokkos_StdAlgorithms.hpp"
 #include <fstream>
 
-Scheduler::Scheduler(const Minisymposia& mini) :
+DeviceScheduler::DeviceScheduler(const DeviceMinisymposia& mini) :
   mini_(mini)
 {
+
+}
+
+template<class Gene>
+BasicScheduler<Gene>::BasicScheduler(const Minisymposia& mini) :
+  DeviceScheduler(mini.device_handle()),
+  host_mini_(mini)
+{
   
 }
 
-Scheduler::ViewType Scheduler::make_initial_population(unsigned nschedules) const {
+template<class Gene>
+typename BasicScheduler<Gene>::ViewType BasicScheduler<Gene>::make_initial_population(unsigned nschedules) const {
   return ViewType("schedules", nschedules, nslots(), nrooms());
 }
 
-bool Scheduler::out_of_bounds(unsigned i) const {
+template<class Gene>
+const typename BasicScheduler<Gene>::DeviceHandle& BasicScheduler<Gene>::device_handle() const {
+  return *this;
+}
+
+template class BasicScheduler<uint16_t>;
+template class BasicScheduler<unsigned>;
+
+size_t DeviceScheduler::team_scratch_size() const {
+  return mini_.team_scratch_size();
+}
+
+bool DeviceScheduler::out_of_bounds(unsigned i) const {
   return i >= mini_.size();
 }
 
+// The room assignment only handles up to max_assigned_rooms rooms; beyond
+// that fix_order keeps the greedy room order
+void DeviceScheduler::set_room_assignment(bool assign_rooms) {
+  assign_rooms_ = assign_rooms && nrooms() <= DeviceMinisymposia::max_assigned_rooms;
+  if(assign_rooms && !assign_rooms_) {
+    printf("Room assignment is ignored: it handles at most %u rooms\n", DeviceMinisymposia::max_assigned_rooms);
+  }
+}
+
+void DeviceScheduler::set_feasible_sampling(bool feasible_sampling) {
+  feasible_sampling_ = feasible_sampling;
+}
+
+// Swapping two rooms of a timeslot does nothing once the rooms are assigned,
+// so the mutations move minisymposia between timeslots instead
+KOKKOS_FUNCTION
+bool DeviceScheduler::mutate_within_rows() const {
+  return !assign_rooms_;
+}
+
 KOKKOS_FUNCTION
-unsigned Scheduler::nslots() const {
-  return mini_.timeslots().size();
+unsigned DeviceScheduler::nslots() const {
+  return mini_.nslots();
 }
 
 KOKKOS_FUNCTION
-unsigned Scheduler::nrooms() const {
-  return mini_.rooms().size();
+unsigned DeviceScheduler::nrooms() const {
+  return mini_.nrooms();
 }
@@ -25,6 +25,10 @@ const std::string& Theme::name() const {
   return theme_map_[id_];
 }
 
+unsigned Theme::id() const {
+  return id_;
+}
+
 unsigned Theme::stem() const {
   // Chop off the last two digits
   return (id_/100)*100;
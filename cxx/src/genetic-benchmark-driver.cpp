@@ -0,0 +1,537 @@
+#include "BlockScheduler.hpp"
+#include "Genetic.hpp"
+#include "Scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Measures the time spent breeding as the population grows
+void benchmark_breeding(Scheduler& s, unsigned ngenerations) {
+  printf("\npopulation size,breeding seconds per generation\n");
+  for(unsigned popSize : {500, 1000, 2000, 5000, 10000, 20000}) {
+    Genetic<Scheduler> g(s);
+    g.run(popSize, popSize/5, 0.01, ngenerations);
+    printf("%i,%lf\n", popSize, g.timings().breed / g.timings().generations);
+  }
+}
+
+// Measures the time spent mutating as the mutation rate grows
+void benchmark_mutation(Scheduler& s, unsigned ngenerations) {
+  printf("\nmutation rate,mutation seconds per generation\n");
+  for(double rate : {0.001, 0.003, 0.01, 0.03, 0.1}) {
+    Genetic<Scheduler> g(s);
+    g.run(1000, 200, rate, ngenerations);
+    printf("%g,%lf\n", rate, g.timings().mutate / g.timings().generations);
+  }
+}
+
+// Compares the time spent in each phase of the separate-kernel pipeline
+// against the fused breed/mutate/rate pass, with and without the full sort
+void benchmark_phases(Scheduler& s, unsigned ngenerations) {
+  printf("\npopulation size,pipeline,ranking,rate,sort,weights,breed,mutate,fused,total seconds per generation\n");
+  for(unsigned popSize : {100, 1000, 10000}) {
+    for(bool fused : {false, true}) {
+      for(bool top_k : {false, true}) {
+        Genetic<Scheduler> g(s);
+        g.set_fused(fused);
+        g.set_top_k_elites(top_k);
+        g.run(popSize, popSize/5, 0.01, ngenerations);
+        const auto& t = g.timings();
+        double n = t.generations;
+        double total = t.rate + t.sort + t.weights + t.breed + t.mutate + t.fused;
+        printf("%i,%s,%s,%lf,%lf,%lf,%lf,%lf,%lf,%lf\n", popSize, fused ? "fused" : "separate",
+               top_k ? "top-k" : "sort", t.rate/n, t.sort/n, t.weights/n, t.breed/n, t.mutate/n, t.fused/n, total/n);
+      }
+    }
+  }
+}
+
+// Runs the algorithm with one crossover operator and selection strategy until
+// it reaches the target rating or the generation limit
+template<class Crossover, class Selection = genetic::RouletteSelection, class Runner>
+void time_to_target(Runner& s, const char* name, unsigned ngenerations, double target) {
+  Genetic<Runner, Crossover, Selection> g(s);
+  g.set_target_rating(target);
+  Kokkos::Timer timer;
+  g.run(1000, 200, 0.01, ngenerations);
+  const auto& t = g.timings();
+  printf("%s,%lf,%i,%lf,%.17g,%s\n", name, timer.seconds(), t.generations, t.weights / t.generations,
+         g.best_rating(), to_string(g.stop_reason()));
+}
+
+// Compares how quickly each crossover operator reaches a target rating
+void benchmark_crossover(Scheduler& s, unsigned ngenerations, double target) {
+  printf("\ncrossover,seconds,generations,selection seconds per generation,best rating,stop reason\n");
+  time_to_target<genetic::PartiallyMappedCrossover>(s, "partially mapped", ngenerations, target);
+  time_to_target<genetic::OrderCrossover>(s, "order", ngenerations, target);
+  time_to_target<genetic::CycleCrossover>(s, "cycle", ngenerations, target);
+  time_to_target<genetic::PositionBasedCrossover>(s, "position based", ngenerations, target);
+}
+
+// Compares how quickly the algorithm reaches a target rating when the genes
+// place every minisymposium in a room against when fix_order assigns the
+// rooms of each timeslot optimally
+void benchmark_rooms(Scheduler& s, unsigned ngenerations, double target) {
+  printf("\nrooms,seconds,generations,selection seconds per generation,best rating,stop reason\n");
+  s.set_room_assignment(false);
+  time_to_target<genetic::PartiallyMappedCrossover>(s, "greedy", ngenerations, target);
+  s.set_room_assignment(true);
+  time_to_target<genetic::PartiallyMappedCrossover>(s, "assigned", ngenerations, target);
+  s.set_room_assignment(false);
+}
+
+// Compares how quickly the algorithm reaches a target rating when each gene
+// is a minisymposium against when each multipart minisymposium is a single
+// gene that BlockScheduler lays out in consecutive timeslots of one room
+void benchmark_blocks(const Minisymposia& mini, unsigned ngenerations, double target) {
+  printf("\nencoding,seconds,generations,selection seconds per generation,best rating,stop reason\n");
+  Scheduler s(mini);
+  time_to_target<genetic::PartiallyMappedCrossover>(s, "minisymposia", ngenerations, target);
+  BlockScheduler b(mini);
+  time_to_target<genetic::PartiallyMappedCrossover>(b, "blocks", ngenerations, target);
+}
+
+// Compares how quickly each selection strategy reaches a target rating, and
+// the time spent preparing the selection each generation
+void benchmark_selection(Scheduler& s, unsigned ngenerations, double target) {
+  using genetic::PartiallyMappedCrossover;
+  printf("\nselection,seconds,generations,selection seconds per generation,best rating,stop reason\n");
+  time_to_target<PartiallyMappedCrossover, genetic::RouletteSelection>(s, "roulette", ngenerations, target);
+  time_to_target<PartiallyMappedCrossover, genetic::TournamentSelection<2>>(s, "tournament 2", ngenerations, target);
+  time_to_target<PartiallyMappedCrossover, genetic::TournamentSelection<4>>(s, "tournament 4", ngenerations, target);
+  time_to_target<PartiallyMappedCrossover, genetic::StochasticUniversalSelection>(s, "stochastic universal", ngenerations, target);
+}
+
+// Compares rating each member with a single thread against rating it with a
+// team.  A population size of zero sweeps a range of sizes.
+void benchmark_team(Scheduler& s, unsigned ngenerations, unsigned popSize) {
+  std::vector<unsigned> sizes{16, 64, 256, 1024, 4096};
+  if(popSize > 0) {
+    sizes = {popSize};
+  }
+  printf("\npopulation size,flat rate seconds per generation,team rate seconds per generation\n");
+  for(unsigned size : sizes) {
+    double seconds[2];
+    for(bool team : {false, true}) {
+      Genetic<Scheduler> g(s);
+      g.set_team_rating(team);
+      g.run(size, size/5, 0.01, ngenerations);
+      seconds[team] = g.timings().rate / (g.timings().generations+1);
+    }
+    printf("%i,%lf,%lf\n", size, seconds[0], seconds[1]);
+  }
+}
+
+// A minimal runner whose members are permutations of any length, so the cost
+// of crossover can be measured independently of the conference data
+class PermutationRunner {
+public:
+  typedef Kokkos::View<unsigned**> ViewType;
+  typedef PermutationRunner DeviceHandle;
+
+  PermutationRunner(unsigned ngenes) : ngenes_(ngenes) { }
+  ViewType make_initial_population(unsigned popSize) const {
+    return ViewType("permutations", popSize, ngenes_);
+  }
+  const DeviceHandle& device_handle() const { return *this; }
+
+  // Rewards genes that are close to their own position
+  template<class View1D>
+  KOKKOS_INLINE_FUNCTION double rate(View1D permutation, bool verbose=false) const {
+    double distance = 0;
+    for(unsigned i=0; i<permutation.extent(0); i++) {
+      distance += Kokkos::abs((double)permutation(i) - i);
+    }
+    return 1.0 / (1.0 + distance);
+  }
+  template<class TeamMember, class View1D>
+  KOKKOS_INLINE_FUNCTION double team_rate(const TeamMember& team, View1D permutation) const {
+    double result;
+    Kokkos::single(Kokkos::PerTeam(team), [&](double& lresult) {
+      lresult = rate(permutation);
+    }, result);
+    return result;
+  }
+  size_t team_scratch_size() const { return 0; }
+  KOKKOS_INLINE_FUNCTION bool out_of_bounds(unsigned i) const { return false; }
+
+  template<class View1D>
+  void greedy(View1D solution) const {
+    for(unsigned i=0; i<solution.extent(0); i++) {
+      solution(i) = solution.extent(0) - 1 - i;
+    }
+  }
+  template<class View1D>
+  void record(const std::string& filename, View1D permutation) const { }
+
+private:
+  unsigned ngenes_;
+};
+
+// Measures how the cost of crossover grows with the number of genes
+void benchmark_pmx(unsigned ngenerations) {
+  printf("\ngenes,breeding seconds per generation\n");
+  for(unsigned ngenes : {64, 256, 1024, 2048, 4096, 8192}) {
+    PermutationRunner runner(ngenes);
+    Genetic<PermutationRunner> g(runner);
+    g.run(1000, 200, 0.01, ngenerations);
+    printf("%i,%lf\n", ngenes, g.timings().breed / g.timings().generations);
+  }
+}
+
+// Compares rating a schedule from scratch after every swap against updating
+// its cached penalties with Minisymposia::swap_and_rate
+void benchmark_delta(const Minisymposia& mini, unsigned nswaps) {
+  auto device_mini = mini.device_handle();
+  unsigned nslots = mini.timeslots().size();
+  unsigned nrooms = mini.rooms().size();
+  Kokkos::View<unsigned**> schedule("schedule", nslots, nrooms);
+  Kokkos::View<unsigned*> positions("positions", mini.size());
+  Kokkos::View<unsigned*[4]> swaps("swaps", nswaps);
+
+  // Start from a random schedule and a random sequence of swaps
+  auto h_schedule = Kokkos::create_mirror_view(schedule);
+  auto h_swaps = Kokkos::create_mirror_view(swaps);
+  std::vector<unsigned> ints(nslots*nrooms);
+  std::iota(ints.begin(), ints.end(), 0);
+  std::default_random_engine rng;
+  std::shuffle(ints.begin(), ints.end(), rng);
+  for(unsigned sl=0; sl<nslots; sl++) {
+    for(unsigned r=0; r<nrooms; r++) {
+      h_schedule(sl,r) = ints[sl*nrooms+r];
+    }
+  }
+  std::uniform_int_distribution<unsigned> slot_dist(0, nslots-1), room_dist(0, nrooms-1);
+  for(unsigned i=0; i<nswaps; i++) {
+    h_swaps(i,0) = slot_dist(rng);
+    h_swaps(i,1) = room_dist(rng);
+    h_swaps(i,2) = slot_dist(rng);
+    h_swaps(i,3) = room_dist(rng);
+  }
+  Kokkos::deep_copy(schedule, h_schedule);
+  Kokkos::deep_copy(swaps, h_swaps);
+
+  Kokkos::Timer timer;
+  double full_score;
+  Kokkos::parallel_reduce("full rating", 1, KOKKOS_LAMBDA (unsigned, double& lscore) {
+    SchedulePenalties penalties;
+    for(unsigned i=0; i<nswaps; i++) {
+      genetic::swap(schedule(swaps(i,0), swaps(i,1)), schedule(swaps(i,2), swaps(i,3)));
+      lscore = device_mini.rate_schedule(schedule, penalties);
+    }
+  }, full_score);
+  double full_time = timer.seconds();
+
+  Kokkos::deep_copy(schedule, h_schedule);
+  timer.reset();
+  double delta_score;
+  Kokkos::parallel_reduce("delta rating", 1, KOKKOS_LAMBDA (unsigned, double& lscore) {
+    SchedulePenalties penalties;
+    device_mini.rate_schedule(schedule, penalties);
+    device_mini.find_positions(schedule, positions);
+    for(unsigned i=0; i<nswaps; i++) {
+      lscore = device_mini.swap_and_rate(schedule, positions, penalties, swaps(i,0), swaps(i,1), swaps(i,2), swaps(i,3));
+    }
+  }, delta_score);
+  double delta_time = timer.seconds();
+
+  printf("\nswaps,full seconds,delta seconds,full score,delta score\n");
+  printf("%i,%lf,%lf,%.17g,%.17g\n", nswaps, full_time, delta_time, full_score, delta_score);
+}
+
+// Compares the cost of launching kernels that capture the whole scheduler,
+// as Genetic used to, against kernels that capture only its device handle
+void benchmark_launch(Scheduler& s, unsigned nlaunches) {
+  Kokkos::View<unsigned*> result("result", 1);
+
+  Kokkos::Timer timer;
+  for(unsigned i=0; i<nlaunches; i++) {
+    Kokkos::parallel_for("capture scheduler", 1, KOKKOS_LAMBDA (unsigned) {
+      result(0) = s.nslots();
+    });
+  }
+  Kokkos::fence();
+  double full_time = timer.seconds();
+
+  Scheduler::DeviceHandle handle = s.device_handle();
+  timer.reset();
+  for(unsigned i=0; i<nlaunches; i++) {
+    Kokkos::parallel_for("capture device handle", 1, KOKKOS_LAMBDA (unsigned) {
+      result(0) = handle.nslots();
+    });
+  }
+  Kokkos::fence();
+  double handle_time = timer.seconds();
+
+  printf("\nlaunches,scheduler seconds per launch,device handle seconds per launch\n");
+  printf("%i,%e,%e\n", nlaunches, full_time/nlaunches, handle_time/nlaunches);
+}
+
+// Compares the device initializer of Genetic against shuffling each member
+// on the host and copying the population to the device, as it used to
+void benchmark_startup(Scheduler& s) {
+  printf("\npopulation size,host shuffle seconds,device initialize seconds\n");
+  for(unsigned popSize : {1000, 10000, 50000}) {
+    Kokkos::Timer timer;
+    auto population = s.make_initial_population(popSize);
+    auto h_population = Kokkos::create_mirror_view(population);
+    std::vector<unsigned> ints(s.nslots()*s.nrooms());
+    std::iota(ints.begin(), ints.end(), 0);
+    std::default_random_engine rng;
+    for(unsigned i=0; i<popSize; i++) {
+      std::shuffle(ints.begin(), ints.end(), rng);
+      for(unsigned j=0, val=0; j<s.nslots(); j++) {
+        for(unsigned k=0; k<s.nrooms(); k++, val++) {
+          h_population(i,j,k) = ints[val];
+        }
+      }
+    }
+    Kokkos::deep_copy(population, h_population);
+    double host_time = timer.seconds();
+
+    Genetic<Scheduler> g(s);
+    g.run(popSize, popSize/5, 0.01, 0);
+    printf("%i,%lf,%lf\n", popSize, host_time, g.timings().initialize);
+  }
+}
+
+// Measures how many members per second one gene width evolves
+template<class Gene>
+void population_throughput(const Minisymposia& mini, unsigned ngenerations) {
+  BasicScheduler<Gene> s(mini);
+  for(unsigned popSize : {1000, 10000, 50000}) {
+    Genetic<BasicScheduler<Gene>> g(s);
+    g.run(popSize, popSize/5, 0.01, ngenerations);
+    const auto& t = g.timings();
+    double n = t.generations;
+    double total = t.rate + t.sort + t.weights + t.breed + t.mutate + t.fused;
+    printf("%zu,%i,%lf,%lf,%lf,%lf,%e\n", sizeof(Gene), popSize, t.breed/n, t.mutate/n, t.rate/n,
+           total/n, popSize*n/total);
+  }
+}
+
+// Compares 32-bit genes against the 16-bit genes genetic::with_gene_type
+// picks when the schedule fits
+void benchmark_throughput(const Minisymposia& mini, unsigned ngenerations) {
+  if(!genetic::fits_gene_type<uint16_t>(mini.nslots()*mini.nrooms())) {
+    printf("The schedule does not fit 16-bit genes\n");
+    return;
+  }
+  printf("\ngene bytes,population size,breed,mutate,rate,total seconds per generation,members per second\n");
+  population_throughput<unsigned>(mini, ngenerations);
+  population_throughput<uint16_t>(mini, ngenerations);
+}
+
+// Compares the pool generator against the counter-based streams enabled by
+// Genetic::set_deterministic.  Deterministic runs print the same best rating
+// for any OMP_NUM_THREADS or backend, so compare the output of two runs.
+void benchmark_determinism(Scheduler& s, unsigned ngenerations, uint64_t seed) {
+  printf("\ngenerator,seconds per generation,best rating,repeat rating\n");
+  for(bool deterministic : {false, true}) {
+    double ratings[2];
+    Kokkos::Timer timer;
+    for(unsigned i=0; i<2; i++) {
+      Genetic<Scheduler> g(s);
+      g.set_deterministic(deterministic);
+      g.run(1000, 200, 0.01, ngenerations, seed);
+      ratings[i] = g.best_rating();
+    }
+    printf("%s,%lf,%.17g,%.17g\n", deterministic ? "counter" : "pool", timer.seconds() / (2*ngenerations),
+           ratings[0], ratings[1]);
+  }
+}
+
+// Reports how many generations the algorithm needs before its best schedule
+// puts every minisymposium in a valid timeslot and its requested room, with
+// and without the sampling enabled by Scheduler::set_feasible_sampling.  The
+// runs are deterministic, so each budget repeats the previous run and
+// continues it, and the budgets double up to ngenerations.
+void benchmark_feasibility(const Minisymposia& mini, Scheduler& s, unsigned ngenerations) {
+  auto device_mini = mini.device_handle();
+  Kokkos::View<unsigned**> schedule("best schedule", mini.nslots(), mini.nrooms());
+  auto h_schedule = Kokkos::create_mirror_view(schedule);
+
+  printf("\nsampling,generations,timeslot penalty,room penalty,best rating\n");
+  for(bool feasible : {false, true}) {
+    s.set_feasible_sampling(feasible);
+    unsigned budget = 0;
+    while(true) {
+      Genetic<Scheduler> g(s);
+      g.set_deterministic(true);
+      auto best = g.run(1000, 200, 0.01, budget);
+      for(unsigned sl=0; sl<mini.nslots(); sl++) {
+        for(unsigned r=0; r<mini.nrooms(); r++) {
+          h_schedule(sl,r) = best(sl,r);
+        }
+      }
+      Kokkos::deep_copy(schedule, h_schedule);
+
+      SchedulePenalties penalties;
+      Kokkos::parallel_reduce("Best penalties", 1, KOKKOS_LAMBDA (unsigned, SchedulePenalties& lpenalties) {
+        device_mini.rate_schedule(schedule, lpenalties);
+      }, Kokkos::Sum<SchedulePenalties>(penalties));
+      printf("%s,%i,%i,%i,%.17g\n", feasible ? "feasible" : "uniform", budget, penalties.timeslot,
+             penalties.room, g.best_rating());
+
+      if((penalties.timeslot == 0 && penalties.room == 0) || budget >= ngenerations) break;
+      budget = std::min(ngenerations, budget > 0 ? 2*budget : 1);
+    }
+  }
+  s.set_feasible_sampling(false);
+}
+
+// Checks the theme penalty that rate_schedule counts from per-timeslot
+// histograms against a reference that sums compute_topic_score over every
+// pair of minisymposia in each timeslot, for random schedules.  Returns
+// whether they agree, so the mode can run as a test.
+bool benchmark_themes(const Minisymposia& mini, unsigned nschedules) {
+  unsigned nslots = mini.nslots();
+  unsigned nrooms = mini.nrooms();
+  unsigned nmini = mini.size();
+  Kokkos::View<unsigned***> schedules("schedules", nschedules, nslots, nrooms);
+  auto h_schedules = Kokkos::create_mirror_view(schedules);
+  std::vector<unsigned> ints(nslots*nrooms);
+  std::iota(ints.begin(), ints.end(), 0);
+  std::default_random_engine rng;
+  for(unsigned i=0; i<nschedules; i++) {
+    std::shuffle(ints.begin(), ints.end(), rng);
+    for(unsigned sl=0; sl<nslots; sl++) {
+      for(unsigned r=0; r<nrooms; r++) {
+        h_schedules(i,sl,r) = ints[sl*nrooms+r];
+      }
+    }
+  }
+  Kokkos::deep_copy(schedules, h_schedules);
+
+  auto device_mini = mini.device_handle();
+  Kokkos::View<double*> themes("theme penalties", nschedules);
+  Kokkos::Timer timer;
+  Kokkos::parallel_for("Theme penalties", nschedules, KOKKOS_LAMBDA (unsigned i) {
+    SchedulePenalties penalties;
+    device_mini.rate_schedule(Kokkos::subview(schedules, i, Kokkos::ALL(), Kokkos::ALL()), penalties);
+    themes(i) = penalties.theme;
+  });
+  Kokkos::fence();
+  double seconds = timer.seconds();
+  auto h_themes = Kokkos::create_mirror_view_and_copy(Kokkos::HostSpace(), themes);
+
+  auto class_codes = mini.class_codes();
+  double total = 0;
+  for(unsigned m1=0; m1<nmini; m1++) {
+    for(unsigned m2=0; m2<nmini; m2++) {
+      if(m1 != m2) total += 2*compute_topic_score(m1, m2, class_codes);
+    }
+  }
+  double max_error = 0;
+  for(unsigned i=0; i<nschedules; i++) {
+    double reference = 0;
+    for(unsigned sl=0; sl<nslots; sl++) {
+      for(unsigned r1=0; r1<nrooms; r1++) {
+        unsigned m1 = h_schedules(i,sl,r1);
+        if(m1 >= nmini) continue;
+        for(unsigned r2=r1+1; r2<nrooms; r2++) {
+          unsigned m2 = h_schedules(i,sl,r2);
+          if(m2 >= nmini) continue;
+          reference += compute_topic_score(m1, m2, class_codes);
+        }
+      }
+    }
+    max_error = std::max(max_error, std::abs(reference / total - h_themes(i)));
+  }
+
+  printf("\nschedules,seconds per rating,max theme penalty error,result\n");
+  bool passed = max_error < 1e-12;
+  printf("%i,%e,%e,%s\n", nschedules, seconds / nschedules, max_error, passed ? "pass" : "FAIL");
+  return passed;
+}
+
+int main(int argc, char* argv[]) {
+  int status = 0;
+  Kokkos::initialize(argc, argv);
+  {
+    std::string benchmark = argc > 1 ? argv[1] : "breed";
+    // The number of generations, or the number of swaps for the delta benchmark
+    unsigned count = argc > 2 ? std::stoi(argv[2]) : 10;
+
+    // Read the themes from yaml
+    Theme::read("../../data/SIAM-CSE23/codes.yaml");
+
+    // Read the citations from yaml
+    Speaker::read("../../data/SIAM-CSE23/citations.yaml");
+
+    // Read the rooms from yaml
+    Rooms rooms("../../data/SIAM-CSE23/rooms.yaml");
+
+    // Read the timeslots from yaml
+    Timeslots tslots("../../data/SIAM-CSE23/timeslots.yaml");
+
+    // Read the minisymposia from yaml
+    Minisymposia mini("../../data/SIAM-CSE23/minisymposia.yaml", rooms, tslots);
+    Scheduler s(mini);
+
+    if(benchmark == "breed") {
+      benchmark_breeding(s, count);
+    }
+    else if(benchmark == "mutate") {
+      benchmark_mutation(s, count);
+    }
+    else if(benchmark == "phases") {
+      benchmark_phases(s, count);
+    }
+    else if(benchmark == "launch") {
+      benchmark_launch(s, count);
+    }
+    else if(benchmark == "delta") {
+      benchmark_delta(mini, count);
+    }
+    else if(benchmark == "crossover") {
+      double target = argc > 3 ? std::stod(argv[3]) : 0.95;
+      benchmark_crossover(s, count, target);
+    }
+    else if(benchmark == "selection") {
+      double target = argc > 3 ? std::stod(argv[3]) : 0.95;
+      benchmark_selection(s, count, target);
+    }
+    else if(benchmark == "rooms") {
+      double target = argc > 3 ? std::stod(argv[3]) : 0.95;
+      benchmark_rooms(s, count, target);
+    }
+    else if(benchmark == "blocks") {
+      double target = argc > 3 ? std::stod(argv[3]) : 0.95;
+      benchmark_blocks(mini, count, target);
+    }
+    else if(benchmark == "feasibility") {
+      benchmark_feasibility(mini, s, count);
+    }
+    else if(benchmark == "themes") {
+      if(!benchmark_themes(mini, count)) {
+        status = 1;
+      }
+    }
+    else if(benchmark == "pmx") {
+      benchmark_pmx(count);
+    }
+    else if(benchmark == "team") {
+      unsigned popSize = argc > 3 ? std::stoi(argv[3]) : 0;
+      benchmark_team(s, count, popSize);
+    }
+    else if(benchmark == "startup") {
+      benchmark_startup(s);
+    }
+    else if(benchmark == "throughput") {
+      benchmark_throughput(mini, count);
+    }
+    else if(benchmark == "determinism") {
+      uint64_t seed = argc > 3 ? std::stoull(argv[3]) : 5374857;
+      benchmark_determinism(s, count, seed);
+    }
+    else {
+      std::cout << "Unknown benchmark " << benchmark << "\n";
+    }
+  }
+  Kokkos::finalize();
+  return status;
+}
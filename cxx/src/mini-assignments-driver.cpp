@@ -16,11 +16,13 @@ int main(int argc, char* argv[]) {
     // Read the minisymposia from yaml
     Minisymposia mini("../../data/SIAM-CSE23/minisymposia.yaml");
  
-    // Run the genetic algorithm
-    Mapper m(lectures, mini, 0);
-    Genetic<Mapper> g(m);
-    auto best_schedule = g.run(1000, 200, 0.01, 100);
-    m.record("lecture-assignments", best_schedule);
+    // Run the genetic algorithm with the narrowest genes that hold every lecture position
+    genetic::with_gene_type(Mapper(lectures, mini, 0).ngenes(), [&](auto gene) {
+      BasicMapper<decltype(gene)> m(lectures, mini, 0);
+      Genetic<decltype(m)> g(m);
+      auto best_schedule = g.run(1000, 200, 0.01, 100);
+      m.record("lecture-assignments", best_schedule);
+    });
 
     // Create a table to display the schedule
   //  Schedule sched(s.get_best_schedule(), &rooms, &mini);
@@ -23,19 +23,34 @@ int main(int argc, char* argv[]) {
     // Read the minisymposia from yaml
     Minisymposia mini("../../data/SIAM-CSE23/minisymposia.yaml", rooms, tslots);
  
-    // Run the genetic algorithm
-    Scheduler s(mini);
-    Genetic<Scheduler> g(s);
-    Kokkos::Timer timer;
-    timer.reset();
-    auto best_schedule = g.run(10000, 2000, 0.01, 1'000'000'000);
-    printf("Runtime: %lf seconds\n", timer.seconds());
-    s.record("schedule.md", best_schedule);
+    // Run the genetic algorithm with the narrowest genes that hold every room of every slot
+    genetic::with_gene_type(mini.nslots()*mini.nrooms(), [&](auto gene) {
+      BasicScheduler<decltype(gene)> s(mini);
+      Genetic<decltype(s)> g(s);
+      // Stop once the schedule reaches the best possible rating or stops improving
+      g.set_target_rating(mini.max_rating());
+      g.set_stall_limit(10000);
+      g.set_checkpoint("schedule.ckpt", 1000);
+      Kokkos::Timer timer;
+      timer.reset();
+      // Pass a checkpoint file to continue an interrupted run
+      std::string checkpoint = argc > 1 ? argv[1] : "";
+      auto best_schedule = checkpoint.empty() ? g.run(10000, 2000, 0.01, 1'000'000'000)
+                                              : g.resume(checkpoint, 2000, 0.01, 1'000'000'000);
+      printf("Runtime: %lf seconds\n", timer.seconds());
+      s.record("schedule.md", best_schedule);
 
-    // Create a table to display the schedule
-    Schedule sched(best_schedule, mini);
+      // Create a table to display the schedule, which expects unsigned indices
+      Kokkos::View<unsigned**, Kokkos::HostSpace> indices("schedule", best_schedule.extent(0), best_schedule.extent(1));
+      for(unsigned i=0; i<indices.extent(0); i++) {
+        for(unsigned j=0; j<indices.extent(1); j++) {
+          indices(i,j) = best_schedule(i,j);
+        }
+      }
+      Schedule sched(indices, mini);
 
-    ret_code = app.exec();
+      ret_code = app.exec();
+    });
   }
   Kokkos::finalize();
   return ret_code;